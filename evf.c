@@ -18,9 +18,17 @@
 #include "port/evf_port.h"
 #include <stddef.h>
 #include <stdbool.h>
+#include <string.h>
+#if (EVF_ISR_PUBLISH_ENABLED == 1)
+#include <stdatomic.h>
+#endif
 
 #define ARRAY_LENGTH(arr)    (sizeof(arr)/sizeof(arr[0]))
 
+#define EVENT_QUEUE_BUFFER_INDEX(index)    ((index) & (EVF_EVENT_QUEUE_LENGTH - 1))
+
+#define ISR_DEFERRAL_RING_INDEX(position)    ((position) & (EVF_ISR_DEFERRAL_RING_LENGTH - 1))
+
 #if (EVF_ASSERTIONS_ENABLED == 1)
 #define EVF_ASSERT(condition)   evf_assert(condition)
 #else
@@ -30,8 +38,17 @@
 #define CONTAINER_OF(p_member, container_type, member_name) \
   ((p_member == NULL) ? NULL : ((container_type *)(((char *)(p_member)) - offsetof(container_type, member_name))))
 
+#if (EVF_SPARSE_EVENT_TYPES_ENABLED == 1)
+#define CHECK_EVENT_TYPE_IS_IN_USER_DEFINED_RANGE(type) \
+    (type >= EVF_USER_EVENT_TYPES_START)
+#else
 #define CHECK_EVENT_TYPE_IS_IN_USER_DEFINED_RANGE(type) \
     ((type >= EVF_USER_EVENT_TYPES_START) && (type < EVF_MAX_NUM_USER_DEFINED_EVENT_TYPES))
+#endif
+
+// Static events are owned by the EVF (e.g. embedded in timers) and are never freed.
+#define EVENT_FLAG_STATIC    (1u << 0)
+#define EVENT_FLAG_REQUEST_HAS_TIMEOUT    (1u << 1)
 
 enum Evf_state 
 {
@@ -41,17 +58,52 @@ enum Evf_state
     EVF_STATE_SHUTDOWN,
 };
 
-struct Active_object_list_item
+#define NUM_SUBSCRIBER_BITSET_WORDS    ((EVF_MAX_NUM_ACTIVE_OBJECTS + 31) / 32)
+
+#if (EVF_STATIC_TOPOLOGY_ENABLED == 0) && (EVF_COMPACT_MEMORY_ENABLED == 1)
+// Bit i (of the words taken together) is set if the active object with index i is subscribed.
+struct Subscription_table_item
 {
-    struct Evf_active_object * p_ao;
-    struct Evf_list_item item;
+    uint32_t subscriber_bitset[NUM_SUBSCRIBER_BITSET_WORDS];
 };
-
+#elif (EVF_STATIC_TOPOLOGY_ENABLED == 0)
 struct Subscription_table_item
 {
     struct Evf_active_object * p_subscribers[EVF_MAX_NUM_ACTIVE_OBJECTS];
     uint32_t num_subscribers;
 };
+#endif
+
+/* Tracks a request that was made with a timeout. The timer's finished event is used as the timeout
+ * event, so a slot can only be reused once that event has been handled.
+ */
+struct Pending_request
+{
+    struct Evf_timer timer;
+    uint32_t correlation_id;
+    bool is_awaiting_reply;
+};
+
+#if (EVF_SPARSE_EVENT_TYPES_ENABLED == 1)
+// An unused event type index entry has the event type EVF_EVENT_TYPE_NULL.
+struct Event_type_index_item
+{
+    int32_t event_type;
+    int32_t index;
+};
+#endif
+
+#if (EVF_ISR_PUBLISH_ENABLED == 1)
+/* A slot's sequence number says whose turn it is: it equals the ring position when the slot is 
+ * free for the producer at that position, and the position + 1 once the event has been written 
+ * (i.e. it is the consumer's turn).
+ */
+struct Isr_deferral_ring_slot
+{
+    atomic_uint_fast32_t sequence;
+    struct Evf_event * p_event;
+};
+#endif
 
 /**************************************************************************************************
  * Static Variables 
@@ -59,394 +111,1743 @@ struct Subscription_table_item
 
 static enum Evf_state evf_state = EVF_STATE_UNINIT;
 
+#if (EVF_STATIC_TOPOLOGY_ENABLED == 1)
+// Generated at compile time by evf_topology.h.
+static struct Evf_active_object * const * const registered_aos = evf_static_registry;
+static struct Evf_static_subscription_table_item const * const subscription_table = 
+    evf_static_subscription_table;
+#else
 static struct Evf_active_object * registered_aos[EVF_MAX_NUM_ACTIVE_OBJECTS];
 static uint32_t num_registered_aos;
 
 static struct Subscription_table_item subscription_table[EVF_MAX_NUM_USER_DEFINED_EVENT_TYPES];
+#endif
 
-// Determines the order that active objects are scheduled to handle events.
-static struct Evf_list priority_scheduling_queue;
+#if (EVF_SCHEDULING_POLICY == EVF_SCHEDULING_POLICY_EDF)
+/* A min-heap of the active objects that have events to handle, ordered by the earliest deadline of
+ * the events in their queues (edf_deadline_timestamp). Since an active object handles its events 
+ * in order, the events in front of the most urgent one inherit its deadline, and so do any 
+ * deferred events of an awaiting active object. An active object is scheduled (i.e. in the heap, 
+ * or handling an event in evf_task) if it has an event that it can handle, see 
+ * find_next_handleable_event. Each active object's edf_heap_position is its index in the heap + 1,
+ * or 0 if it is not in the heap (so that zero-initialised active objects are not in the heap).
+ */
+static struct Evf_active_object * edf_ready_heap[EVF_MAX_NUM_ACTIVE_OBJECTS];
+static uint32_t edf_ready_heap_length;
+
+static Evf_deadline_miss_hook deadline_miss_hook;
+#else
+/* The active objects that have events to handle, one list per priority level. Active objects of 
+ * the same priority are scheduled round-robin. An active object is scheduled (i.e. in its ready 
+ * list, or handling events in evf_task) if, and only if, it has an event that it can handle (see
+ * find_next_handleable_event).
+ */
+static struct Evf_list ready_lists[EVF_ACTIVE_OBJECT_PRIORITY_MAX+1];
+static uint32_t num_scheduled_aos;
+#endif
 
 // Sorted in order of nearest deadline.
 static struct Evf_list running_timers_list; 
 
+// The timestamp that the timer handler callback is currently scheduled for (-1 if none).
+static int64_t scheduled_timer_callback_timestamp;
+
+// Indexed by event type index, see evf_get_event_type_index.
 static Evf_event_destructor event_destructors[EVF_MAX_NUM_USER_DEFINED_EVENT_TYPES];
 
+#if (EVF_SPARSE_EVENT_TYPES_ENABLED == 1)
+// Maps event types to their indices, using open addressing with linear probing.
+static struct Event_type_index_item event_type_index[EVF_EVENT_TYPE_INDEX_LENGTH];
+static int32_t num_indexed_event_types;
+#endif
+
+static Evf_event_hook event_hook;
+
+static struct Pending_request pending_requests[EVF_MAX_NUM_PENDING_REQUESTS];
+static uint32_t next_correlation_id;
+
+#if (EVF_ISR_PUBLISH_ENABLED == 1)
+/* A bounded multi-producer (ISRs/signal handlers, which may nest), single-consumer (evf_task) 
+ * lock-free ring. Positions are free-running.
+ */
+static struct Isr_deferral_ring_slot isr_deferral_ring[EVF_ISR_DEFERRAL_RING_LENGTH];
+static atomic_uint_fast32_t isr_deferral_ring_write_position;
+static uint_fast32_t isr_deferral_ring_read_position; // Only used by the consumer.
+#endif
+
+#if (EVF_RTC_BUDGETS_ENABLED == 1)
+static Evf_rtc_budget_overrun_hook rtc_budget_overrun_hook;
+
+// Only valid while is_rtc_step_in_progress, protected by the critical section.
+static struct Evf_rtc_step_info current_rtc_step;
+static bool is_rtc_step_in_progress;
+#endif
+
+/* The RAM used by each part of the EVF's state (see evf_ram_usage). Const tables (e.g. the static
+ * topology) are not counted since they can live in read-only memory.
+ */
+#if (EVF_STATIC_TOPOLOGY_ENABLED == 1)
+#define REGISTRY_RAM_BYTES              0
+#define SUBSCRIPTION_TABLE_RAM_BYTES    0
+#else
+#define REGISTRY_RAM_BYTES              (sizeof(registered_aos) + sizeof(num_registered_aos))
+#define SUBSCRIPTION_TABLE_RAM_BYTES    sizeof(subscription_table)
+#endif
+
+#if (EVF_SCHEDULING_POLICY == EVF_SCHEDULING_POLICY_EDF)
+#define SCHEDULER_RAM_BYTES    (sizeof(edf_ready_heap) + sizeof(edf_ready_heap_length))
+#else
+#define SCHEDULER_RAM_BYTES    (sizeof(ready_lists) + sizeof(num_scheduled_aos))
+#endif
+
+#if (EVF_SPARSE_EVENT_TYPES_ENABLED == 1)
+#define EVENT_TYPE_INDEX_RAM_BYTES    (sizeof(event_type_index) + sizeof(num_indexed_event_types))
+#else
+#define EVENT_TYPE_INDEX_RAM_BYTES    0
+#endif
+
+#if (EVF_ISR_PUBLISH_ENABLED == 1)
+#define ISR_DEFERRAL_RING_RAM_BYTES \
+    (sizeof(isr_deferral_ring) + sizeof(isr_deferral_ring_write_position) + sizeof(isr_deferral_ring_read_position))
+#else
+#define ISR_DEFERRAL_RING_RAM_BYTES    0
+#endif
+
+#if (EVF_SCHEDULING_POLICY == EVF_SCHEDULING_POLICY_EDF)
+#define SCHEDULER_HOOKS_RAM_BYTES    sizeof(deadline_miss_hook)
+#else
+#define SCHEDULER_HOOKS_RAM_BYTES    0
+#endif
+
+#if (EVF_RTC_BUDGETS_ENABLED == 1)
+#define RTC_BUDGETS_RAM_BYTES \
+    (sizeof(rtc_budget_overrun_hook) + sizeof(current_rtc_step) + sizeof(is_rtc_step_in_progress))
+#else
+#define RTC_BUDGETS_RAM_BYTES    0
+#endif
+
+#define OTHER_RAM_BYTES \
+    (sizeof(evf_state) + sizeof(running_timers_list) + sizeof(scheduled_timer_callback_timestamp) \
+     + sizeof(event_hook) + sizeof(next_correlation_id) + SCHEDULER_HOOKS_RAM_BYTES + RTC_BUDGETS_RAM_BYTES)
+
+#define TOTAL_RAM_BYTES \
+    (REGISTRY_RAM_BYTES + SUBSCRIPTION_TABLE_RAM_BYTES + SCHEDULER_RAM_BYTES + sizeof(event_destructors) \
+     + EVENT_TYPE_INDEX_RAM_BYTES + sizeof(pending_requests) + ISR_DEFERRAL_RING_RAM_BYTES + OTHER_RAM_BYTES)
+
+#ifdef EVF_RAM_BUDGET_BYTES
+_Static_assert(TOTAL_RAM_BYTES <= EVF_RAM_BUDGET_BYTES, "The EVF's state exceeds EVF_RAM_BUDGET_BYTES");
+#endif
+
+struct Evf_ram_usage const evf_ram_usage = {
+    .active_object_bytes      = sizeof(struct Evf_active_object),
+    .timer_bytes              = sizeof(struct Evf_timer),
+    .registry_bytes           = REGISTRY_RAM_BYTES,
+    .subscription_table_bytes = SUBSCRIPTION_TABLE_RAM_BYTES,
+    .scheduler_bytes          = SCHEDULER_RAM_BYTES,
+    .event_destructors_bytes  = sizeof(event_destructors),
+    .event_type_index_bytes   = EVENT_TYPE_INDEX_RAM_BYTES,
+    .pending_requests_bytes   = sizeof(pending_requests),
+    .isr_deferral_ring_bytes  = ISR_DEFERRAL_RING_RAM_BYTES,
+    .other_bytes              = OTHER_RAM_BYTES,
+    .total_bytes              = TOTAL_RAM_BYTES,
+};
+
 /**************************************************************************************************
  * Static Functions 
  *************************************************************************************************/
 
-static void evf_event_queue_init(struct Evf_event_queue * p_queue)
+// The event queue helpers take the active object, since it holds the queue's indices.
+static void evf_event_queue_init(struct Evf_active_object * p_ao)
+{
+    p_ao->event_queue_wi = 0;
+    p_ao->event_queue_ri = 0;
+}
+
+static uint32_t evf_event_queue_get_length(struct Evf_active_object const * p_ao)
 {
-    p_queue->num_in_queue = 0;
-    p_queue->wi = 0;
-    p_queue->ri = 0;
+    // Unsigned arithmetic handles the indices wrapping around (at the width of the index type).
+    return (Evf_queue_index)(p_ao->event_queue_wi - p_ao->event_queue_ri);
 }
 
-static bool evf_event_queue_push_back(struct Evf_event_queue * p_queue, 
+static bool evf_event_queue_push_back(struct Evf_active_object * p_ao, 
                                       struct Evf_event * p_event)
 {
-    if (p_queue->num_in_queue >= ARRAY_LENGTH(p_queue->p_event_buffer)) { return false; }
+    if (evf_event_queue_get_length(p_ao) >= EVF_EVENT_QUEUE_LENGTH) { return false; }
 
-    p_queue->p_event_buffer[p_queue->wi] = p_event;
-    p_queue->wi = (p_queue->wi == ARRAY_LENGTH(p_queue->p_event_buffer)-1) ? 0 : (p_queue->wi + 1);
-    p_queue->num_in_queue++;
+    p_ao->event_queue.p_event_buffer[EVENT_QUEUE_BUFFER_INDEX(p_ao->event_queue_wi)] = p_event;
+    p_ao->event_queue_wi++;
 
     return true;
 }
 
-static struct Evf_event * evf_event_queue_pop_front(struct Evf_event_queue * p_queue)
+static struct Evf_event * evf_event_queue_pop_front(struct Evf_active_object * p_ao)
 {
-    if (p_queue->num_in_queue == 0) { return NULL; }
+    if (evf_event_queue_get_length(p_ao) == 0) { return NULL; }
 
-    struct Evf_event * p_event = p_queue->p_event_buffer[p_queue->ri]; 
-    p_queue->ri = (p_queue->ri == 0) ? (ARRAY_LENGTH(p_queue->p_event_buffer)-1) : (p_queue->ri - 1);
-    p_queue->num_in_queue--;
+    struct Evf_event * p_event = 
+        p_ao->event_queue.p_event_buffer[EVENT_QUEUE_BUFFER_INDEX(p_ao->event_queue_ri)];
+    p_ao->event_queue_ri++;
 
     return p_event;
 }
 
-static bool check_evf_state_allows_active_objects_to_receive_events()
+// Takes the event at index out of the queue. The events in front of it keep their order.
+static struct Evf_event * evf_event_queue_take(struct Evf_active_object * p_ao, Evf_queue_index index)
 {
-    /* As soon as the EVF is initialised, active objects can receive events, however they will not
-     * be handled until evf_task starts being called. Also, as soon as the EVF goes into shutdown 
-     * mode, no more events can be received TODO: is this right?
-     */
-    return (evf_state == EVF_STATE_INIT_NOT_RUNNING)
-        || (evf_state == EVF_STATE_RUNNING);
+    struct Evf_event_queue * p_queue = &p_ao->event_queue;
+    struct Evf_event * p_event = p_queue->p_event_buffer[EVENT_QUEUE_BUFFER_INDEX(index)];
+    for (; index != p_ao->event_queue_ri; index--)
+    {
+        Evf_queue_index previous_index = index - 1;
+        p_queue->p_event_buffer[EVENT_QUEUE_BUFFER_INDEX(index)] = 
+            p_queue->p_event_buffer[EVENT_QUEUE_BUFFER_INDEX(previous_index)];
+#if (EVF_SCHEDULING_POLICY == EVF_SCHEDULING_POLICY_EDF)
+        p_queue->deadline_timestamps[EVENT_QUEUE_BUFFER_INDEX(index)] = 
+            p_queue->deadline_timestamps[EVENT_QUEUE_BUFFER_INDEX(previous_index)];
+#endif
+    }
+    p_ao->event_queue_ri++;
+
+    return p_event;
 }
 
-static struct Evf_active_object * get_next_scheduled_active_object()
+#if (EVF_COROUTINES_ENABLED == 1)
+static bool check_event_is_awaited(struct Evf_active_object const * p_ao, struct Evf_event const * p_event)
 {
-    struct Active_object_list_item * p_next = CONTAINER_OF(priority_scheduling_queue.p_head,
-                                                           struct Active_object_list_item,
-                                                           item);
-    if (p_next == NULL)
+    if ((p_event->type == p_ao->awaited_event_type) || (p_event->type == EVF_EVENT_TYPE_SHUTDOWN_PENDING))
     {
-        return NULL;
-    } 
-
-    struct Evf_active_object * p_next_scheduled = p_next->p_ao;
-    evf_list_remove_item(&priority_scheduling_queue, &p_next->item);
-    evf_free(p_next);
+        return true;
+    }
 
-    return p_next_scheduled;
+    return (p_event->type == EVF_EVENT_TYPE_TIMER_FINISHED)
+        && (((struct Evf_event_timer_finished const *)p_event)->timer_id == p_ao->awaited_timer_id);
 }
+#endif
 
-static void schedule_active_object_rtc_step(struct Evf_active_object * p_ao)
+/* Finds the next event that the active object can handle: the front event or, while it is awaiting
+ * (see evf_await), the first awaited event. The events in front of an awaited one are deferred, 
+ * i.e. they stay queued, in order, until the await has ended. Returns false if there is no such 
+ * event. Must be called within a critical section.
+ */
+static bool find_next_handleable_event(struct Evf_active_object const * p_ao, Evf_queue_index * p_index)
 {
-    // TODO: consider having an internal allocator for quicker allocation here.
-    struct Active_object_list_item * p_to_insert = evf_malloc(sizeof(struct Active_object_list_item));
-    EVF_ASSERT(p_to_insert != NULL);
-    p_to_insert->p_ao = p_ao;
-
-    /* The AO's RTC (run-to-completion) step is scheduled to occur after any same or higher
-     * priority AO RTC steps (i.e. before any of lower priority).        
-     */
-    struct Active_object_list_item * p_curr = CONTAINER_OF(priority_scheduling_queue.p_head,
-                                                           struct Active_object_list_item,
-                                                           item);
-    struct Active_object_list_item * p_first_of_lower_priority = NULL;
-    while (p_curr != NULL)
+#if (EVF_COROUTINES_ENABLED == 1)
+    if (p_ao->is_awaiting)
     {
-        if (p_curr->p_ao->priority < p_ao->priority)
+        for (Evf_queue_index index = p_ao->event_queue_ri; index != p_ao->event_queue_wi; index++)
         {
-            p_first_of_lower_priority = p_curr;
-            break;
+            if (check_event_is_awaited(p_ao, p_ao->event_queue.p_event_buffer[EVENT_QUEUE_BUFFER_INDEX(index)]))
+            {
+                *p_index = index;
+                return true;
+            }
         }
+        return false;
     }
+#endif
 
-    if (p_first_of_lower_priority == NULL)
-    {
-        evf_list_append(&priority_scheduling_queue, &p_to_insert->item);
-    }
-    else
-    {
-        evf_list_insert_before(&priority_scheduling_queue,
-                               &p_to_insert->item,
-                               &p_first_of_lower_priority->item);
-    }
+    *p_index = p_ao->event_queue_ri;
+    return (evf_event_queue_get_length(p_ao) != 0);
 }
 
-static void subscription_table_init()
+static bool check_active_object_has_handleable_event(struct Evf_active_object const * p_ao)
 {
-    for (uint32_t event_type = 0; event_type < EVF_MAX_NUM_USER_DEFINED_EVENT_TYPES; event_type++)
-    {
-        subscription_table[event_type].num_subscribers = 0;
-    }
+    Evf_queue_index index;
+    return find_next_handleable_event(p_ao, &index);
 }
 
-static void event_type_destructors_init()
+/* Takes the event at index (see find_next_handleable_event) for handling. Taking an awaited event
+ * ends the await. Must be called within a critical section.
+ */
+static struct Evf_event * take_handleable_event(struct Evf_active_object * p_ao, Evf_queue_index index)
 {
-    for (uint32_t event_type = 0; event_type < EVF_MAX_NUM_USER_DEFINED_EVENT_TYPES; event_type++)
-    {
-        event_destructors[event_type] = NULL;
-    }
+#if (EVF_COROUTINES_ENABLED == 1)
+    p_ao->is_awaiting = false;
+#endif
+    return evf_event_queue_take(p_ao, index);
 }
 
-static void add_event_subscriber(int32_t event_type, struct Evf_active_object * p_ao)
+static bool check_active_object_accepts_event(struct Evf_active_object const * p_ao,
+                                              struct Evf_event const * p_event)
 {
-    struct Subscription_table_item * p_item = &subscription_table[event_type];
-    EVF_ASSERT(p_item->num_subscribers < EVF_MAX_NUM_ACTIVE_OBJECTS);
-    p_item->p_subscribers[p_item->num_subscribers++] = p_ao;
+    return (p_ao->accepts_event == NULL) || p_ao->accepts_event(p_ao, p_event);
 }
 
-static void event_ref_count_init(struct Evf_event * p_event)
+/* An event that an idle active object (i.e. not scheduled, so not handling an event either, and 
+ * with an empty queue) would ignore is dropped rather than queued, so that it never gets scheduled.
+ * Otherwise the active object's state may change before the event reaches the front of the queue, 
+ * so it is checked again when it is taken. Must be called within a critical section.
+ */
+static bool check_event_is_dropped_on_delivery(struct Evf_active_object const * p_ao,
+                                               struct Evf_event const * p_event)
 {
-    p_event->ref_count = 0;
+    return !p_ao->is_scheduled
+        && (evf_event_queue_get_length(p_ao) == 0)
+        && !check_active_object_accepts_event(p_ao, p_event);
 }
 
-static bool post_event_to_active_object(struct Evf_active_object * p_ao, struct Evf_event * p_event)
+static bool check_evf_state_allows_active_objects_to_receive_events()
 {
-    bool was_posted = false;
-    if (evf_event_queue_push_back(&p_receiver->event_queue, p_event))
-    {
-        p_event->ref_count++;
-        schedule_active_object_rtc_step(p_ao);
-        was_posted = true;
-    }
+    /* As soon as the EVF is initialised, active objects can receive events, however they will not
+     * be handled until evf_task starts being called. Also, as soon as the EVF goes into shutdown 
+     * mode, no more events can be received TODO: is this right?
+     * Events may be posted from other threads, so the state is read in a critical section.
+     */
+    evf_critical_section_enter();
+    bool allows = (evf_state == EVF_STATE_INIT_NOT_RUNNING)
+               || (evf_state == EVF_STATE_RUNNING);
+    evf_critical_section_exit();
 
-    return was_posted;
+    return allows;
 }
 
-static void destroy_event_reference(struct Evf_event * p_event)
+#if (EVF_SCHEDULING_POLICY == EVF_SCHEDULING_POLICY_EDF)
+// Returns UINT64_MAX if the queue is empty.
+static uint64_t get_earliest_queued_deadline(struct Evf_active_object const * p_ao)
 {
-    p_event->ref_count--;
-    if (p_event->ref_count == 0)
+    struct Evf_event_queue const * p_queue = &p_ao->event_queue;
+    uint64_t earliest_deadline = UINT64_MAX;
+    for (Evf_queue_index index = p_ao->event_queue_ri; index != p_ao->event_queue_wi; index++)
     {
-        Evf_event_destructor dtor = event_destructors[p_event->type];
-        if (dtor != NULL) { dtor(p_event); }
-        evf_free(p_event);
+        uint64_t deadline = p_queue->deadline_timestamps[EVENT_QUEUE_BUFFER_INDEX(index)];
+        if (deadline < earliest_deadline) { earliest_deadline = deadline; }
     }
+
+    return earliest_deadline;
 }
 
-static void handle_timer_handler_callback_scheduling()
+static void edf_ready_heap_set(uint32_t index, struct Evf_active_object * p_ao)
 {
-    struct Evf_timer * p_next_to_finish = CONTAINER_OF(running_timers_list.p_head, struct Evf_timer, item);
-    if (p_next_to_finish != NULL)
-    {
-        evf_schedule_callback(p_next_to_finish->finish_time, &timer_handler_callback);
-    }
-    else // There is no next to finish so no reason to have a callback scheduled...
-    {
-        evf_cancel_scheduled_callback();
-    }
+    edf_ready_heap[index] = p_ao;
+    p_ao->edf_heap_position = index + 1;
 }
 
-static void running_timers_list_add_timer(struct Evf_timer * p_timer)
+static void edf_ready_heap_swap(uint32_t index_a, uint32_t index_b)
 {
-    // Running timers list is sorted in order of increasing finish time.
-    struct Evf_list_item * p_curr = running_timers_list.p_head;
-    struct Evf_timer * p_curr_timer = NULL;
-    do 
-    {
-        p_curr_timer = CONTAINER_OF(p_curr, struct Evf_timer, item);
-    } while((p_timer->finish_time >= p_curr_timer->finish_time)
-        && ((p_curr = p_curr->p_next) != NULL));
-
-    if (p_curr == NULL) { evf_list_append(&running_timers_list, &p_timer->item); }
-    else { evf_list_insert_after(&running_timers_list, &p_timer->item, p_curr); }
+    struct Evf_active_object * p_temp = edf_ready_heap[index_a];
+    edf_ready_heap_set(index_a, edf_ready_heap[index_b]);
+    edf_ready_heap_set(index_b, p_temp);
+}
 
-    // Re-schedule the timer handling callback if new timer is next to finish.
-    if (evf_list_check_item_is_head(&running_timers_list, &p_timer->item))
+static void edf_ready_heap_sift_up(uint32_t index)
+{
+    uint64_t deadline = edf_ready_heap[index]->edf_deadline_timestamp;
+    while (index > 0)
     {
-        handle_timer_handler_callback_scheduling();
+        uint32_t parent_index = (index - 1) / 2;
+        if (edf_ready_heap[parent_index]->edf_deadline_timestamp <= deadline) { break; }
+
+        edf_ready_heap_swap(index, parent_index);
+        index = parent_index;
     }
 }
 
-static void running_timers_list_remove_timer(struct Evf_timer * p_timer)
+static void edf_ready_heap_insert(struct Evf_active_object * p_ao)
 {
-    // If timer being removed is the next to finish, then we now have a new 'next to finish'...
-    bool was_next_to_finish = evf_list_check_item_is_head(&running_timers_list, &p_timer->item);
-    evf_list_remove_item(&running_timers_list, &p_timer->item);
-    if (was_next_to_finish)
-    {
-        handle_timer_handler_callback_scheduling();
-    }    
+    EVF_ASSERT(edf_ready_heap_length < EVF_MAX_NUM_ACTIVE_OBJECTS);
+
+    uint32_t index = edf_ready_heap_length++;
+    edf_ready_heap_set(index, p_ao);
+    edf_ready_heap_sift_up(index);
 }
 
-static void timer_handler_callback()
+static struct Evf_active_object * edf_ready_heap_pop()
 {
-    /* TODO: consider making this a bit more sophisticated. If there are many timers to go off 
-     * at a time then 'now' may be outdated and we may miss the deadline of some timers.
-     */
-    uint64_t now = evf_get_timestamp_ms();
+    if (edf_ready_heap_length == 0) { return NULL; }
 
-    evf_critical_section_enter();
-    struct Evf_list_item * p_curr_item = running_timers_list.p_head;
-    struct Evf_timer * p_curr_timer = NULL;
-    do 
+    struct Evf_active_object * p_earliest = edf_ready_heap[0];
+    edf_ready_heap_set(0, edf_ready_heap[--edf_ready_heap_length]);
+    p_earliest->edf_heap_position = 0;
+
+    // Sift down.
+    uint32_t index = 0;
+    while (true)
     {
-        p_curr_timer = CONTAINER_OF(p_curr_item, struct Evf_timer, item);
-        if (p_curr_timer->finish_time >= now)
+        uint32_t smallest_index = index;
+        uint32_t child_indexes[] = { (2 * index) + 1, (2 * index) + 2 };
+        for (uint32_t i = 0; i < ARRAY_LENGTH(child_indexes); i++)
         {
-            /* TODO: consider moving the event allocation and posting out of the critical section.
-             * If we just remove the finished timers from the running timers list and then exit 
-             * the critical section then higher priority interrupts, or any interrupt if timers are
-             * handled in the application superloop, can execute. This is not a priority at the
-             * moment, do some tests later to check execution speed.  
-             */
-            struct Evf_event_timer_finished * p_event = EVF_EVENT_ALLOC(struct Evf_event_timer_finished);
-            evf_event_set_type(p_event, EVF_EVENT_TYPE_TIMER_FINISHED);
-            p_event->timer_id = p_curr_timer->timer_id;
-            event_ref_count_init(p_event);
-            bool okay = post_event_to_active_object(p_curr_timer->p_owner, p_event);
-
-            evf_list_remove_item(&running_timers_list, p_curr_item); //NOTE: cant do this before setting the next.
-        }
-        else // Since running timers list is sorted by increasing finish time...
-        {
-            break;
+            if ((child_indexes[i] < edf_ready_heap_length)
+                && (edf_ready_heap[child_indexes[i]]->edf_deadline_timestamp
+                    < edf_ready_heap[smallest_index]->edf_deadline_timestamp))
+            {
+                smallest_index = child_indexes[i];
+            }
         }
+        if (smallest_index == index) { break; }
 
-    } while((p_curr_item = p_curr_item->p_next) != NULL);
-    evf_critical_section_exit();
+        edf_ready_heap_swap(index, smallest_index);
+        index = smallest_index;
+    }
 
-    handle_timer_handler_callback_scheduling();
+    return p_earliest;
 }
 
-static void add_active_object_to_registered_array(struct Evf_active_object * p_ao)
+static void edf_schedule_active_object(struct Evf_active_object * p_ao)
 {
-    EVF_ASSERT(num_registered_aos < EVF_MAX_NUM_ACTIVE_OBJECTS);
-    registered_aos[num_registered_aos++] = p_ao;
+    if (!p_ao->is_scheduled && check_active_object_has_handleable_event(p_ao))
+    {
+        p_ao->is_scheduled = true;
+        p_ao->edf_deadline_timestamp = get_earliest_queued_deadline(p_ao);
+        edf_ready_heap_insert(p_ao);
+    }
 }
 
-static void register_active_object_event_type_subscriptions(struct Evf_active_object * p_ao)
+/* Called when an event has been queued. An active object that is already in the heap inherits the
+ * event's deadline if it is earlier than its own.
+ */
+static void edf_handle_queued_event(struct Evf_active_object * p_ao, uint64_t deadline_timestamp)
 {
-    int32_t curr_type;
-    for (uint32_t i = 0; (curr_type = p_ao->event_type_subscriptions[i]) != EVF_EVENT_TYPE_NULL; i++)
+    if (p_ao->edf_heap_position == 0)
     {
-        EVF_ASSERT(i < EVF_ACTIVE_OBJECT_MAX_NUM_SUBSCRIPTIONS);
-        EVF_ASSERT(CHECK_EVENT_TYPE_IS_VALID(curr_type));
-        add_event_subscriber(p_ao->event_type_subscriptions[i], p_ao);    
+        edf_schedule_active_object(p_ao);
+    }
+    else if (deadline_timestamp < p_ao->edf_deadline_timestamp)
+    {
+        p_ao->edf_deadline_timestamp = deadline_timestamp;
+        edf_ready_heap_sift_up(p_ao->edf_heap_position - 1);
     }
 }
 
-/**************************************************************************************************
- * EVF API function implementations
- *************************************************************************************************/
-
-void evf_init()
+// Called when an active object has finished handling an event.
+static void edf_reschedule_active_object(struct Evf_active_object * p_ao)
 {
-    EVF_ASSERT(evf_state == EVF_STATE_UNINIT);
-    num_registered_aos = 0;
-    subscription_table_init();
-    event_type_destructors_init();
-    evf_list_init(&running_timers_list);
-    evf_state = EVF_STATE_INIT_NOT_RUNNING;
+    p_ao->is_scheduled = false;
+    edf_schedule_active_object(p_ao);
 }
 
-void evf_register_active_object(struct Evf_active_object * p_ao)
+static uint64_t get_default_deadline_timestamp(struct Evf_active_object const * p_ao)
 {
-    EVF_ASSERT(evf_state == EVF_STATE_INIT_NOT_RUNNING);
-    EVF_ASSERT(p_ao != NULL);
-
-    add_active_object_to_registered_array(p_ao);
-    register_active_object_event_type_subscriptions(p_ao);
+    uint32_t deadline_ms = (p_ao->default_deadline_ms != 0) ? p_ao->default_deadline_ms
+                                                            : EVF_DEFAULT_DEADLINE_MS;
+    return evf_get_timestamp_ms() + deadline_ms;
 }
 
-void evf_publish(struct Active_object * p_publisher, struct Evf_event * p_event)
+/* Takes the event with the earliest deadline (and its active object) for handling. Returns NULL
+ * if there are no events to handle. The active object stays scheduled while it handles the event,
+ * and goes back in the heap afterwards (see edf_reschedule_active_object). Must be called within 
+ * a critical section.
+ */
+static struct Evf_event * take_next_scheduled_event(struct Evf_active_object ** pp_ao,
+                                                    uint64_t * p_deadline_timestamp)
 {
-    EVF_ASSERT(p_event != NULL);
-    EVF_ASSERT(check_evf_state_allows_active_objects_to_receive_events());
-
-    struct Subscription_table_item const * p_item = &subscription_table[p_event->type];
-    for (uint32_t i = 0; i < p_item->num_subscribers; i++)
+    /* An active object that started awaiting (see evf_await) after it was put in the heap may no
+     * longer have an event that it can handle, in which case it stays out of the heap.
+     */
+    struct Evf_active_object * p_ao;
+    Evf_queue_index index;
+    do
     {
-        struct Evf_active_object * p_receiver = p_item->p_subscribers[i];
-
-        // Published events don't go to the active object that is doing the publishing.
-        if (p_receiver == p_publisher)
-        {
-            continue;
-        }
+        p_ao = edf_ready_heap_pop();
+        if (p_ao == NULL) { return NULL; }
+        if (find_next_handleable_event(p_ao, &index)) { break; }
+        p_ao->is_scheduled = false;
+    } while (true);
+
+    *p_deadline_timestamp = p_ao->event_queue.deadline_timestamps[EVENT_QUEUE_BUFFER_INDEX(index)];
+    *pp_ao = p_ao;
+    return take_handleable_event(p_ao, index);
+}
 
-        /* Events may be posted from (other) ISRs/threads so we need to protect each post 
-         * from pre-emption.
-         */
-        evf_critical_section_enter();
-        post_event_to_active_object(p_receiver, p_event);
-        evf_critical_section_exit();
+static void check_for_deadline_miss(struct Evf_active_object * p_ao,
+                                    struct Evf_event const * p_event,
+                                    uint64_t deadline_timestamp)
+{
+    uint64_t now = evf_get_timestamp_ms();
+    if (now > deadline_timestamp)
+    {
+        p_ao->num_deadline_misses++;
+        if (deadline_miss_hook != NULL) { deadline_miss_hook(p_ao, p_event, now - deadline_timestamp); }
     }
-};
-
-bool evf_post(struct Evf_active_object * p_receiver, struct Evf_event * p_event)
+}
+#else
+static void ready_lists_init()
 {
-    EVF_ASSERT(check_evf_state_allows_active_objects_to_receive_events());
-    EVF_ASSERT(p_receiver != NULL);
-    EVF_ASSERT(p_event != NULL);
-    EVF_ASSERT(CHECK_EVENT_TYPE_IS_IN_USER_DEFINED_RANGE(event_type));
-
-    event_ref_count_init(p_event);
-
-    evf_critical_section_enter();
-    bool okay = post_event_to_active_object(p_receiver, p_event);
-    evf_critical_section_exit();
-
-    return okay;
-};
+    for (uint32_t priority = 0; priority < ARRAY_LENGTH(ready_lists); priority++)
+    {
+        evf_list_init(&ready_lists[priority]);
+    }
+    num_scheduled_aos = 0;
+}
 
-void evf_timer_init(struct Evf_timer * p_timer)
+static void schedule_active_object(struct Evf_active_object * p_ao)
 {
-    // -1 indicates that the timer is not running i.e. not in the running timers list.
-    p_timer->finish_timestamp = -1;
-    evf_list_item_init(&p_timer->item);
+    if (!p_ao->is_scheduled)
+    {
+        p_ao->is_scheduled = true;
+        num_scheduled_aos++;
+        evf_list_append(&ready_lists[p_ao->priority], &p_ao->ready_item);
+    }
 }
 
-void evf_timer_start(struct Evf_timer * p_timer)
+// Takes the active object at the front of the highest priority non-empty ready list.
+static struct Evf_active_object * take_next_scheduled_active_object()
 {
-    EVF_ASSERT(p_timer != NULL);
-    EVF_ASSERT(p_timer->p_owner != NULL);
-
-    evf_critical_section_enter();
-
-    if (p_timer->finish_timestamp != -1)
+    for (uint32_t priority = 0; priority < ARRAY_LENGTH(ready_lists); priority++)
     {
-        running_timers_list_remove_timer(p_timer);
+        struct Evf_active_object * p_ao = CONTAINER_OF(ready_lists[priority].p_head,
+                                                       struct Evf_active_object,
+                                                       ready_item);
+        if (p_ao != NULL)
+        {
+            evf_list_remove_item(&ready_lists[priority], &p_ao->ready_item);
+            return p_ao;
+        }
     }
-    p_timer->finish_time = evf_get_timestamp_ms() + p_timer->time_ms;
-    running_timers_list_add_timer(p_timer);
 
-    evf_critical_section_exit();
+    return NULL;
 }
 
-void evf_timer_stop(struct Evf_timer * p_timer)
+static bool check_if_higher_priority_active_object_is_ready(uint8_t priority)
 {
-    EVF_ASSERT(p_timer != NULL);
-
-    evf_critical_section_enter();
-
-    running_timers_list_remove_timer(p_timer);
-    p_timer->finish_timestamp = -1;
+    for (uint32_t higher_priority = 0; higher_priority < priority; higher_priority++)
+    {
+        if (evf_list_get_length(&ready_lists[higher_priority]) != 0) { return true; }
+    }
 
-    evf_critical_section_exit();
+    return false;
 }
 
-enum Evf_status evf_task()
+/* Called when an active object has finished its burst. It goes to the back of its ready list 
+ * (behind the others of the same priority) if it still has events to handle.
+ */
+static void reschedule_active_object(struct Evf_active_object * p_ao)
 {
-    struct Evf_active_object * p_ao = get_next_scheduled_active_object();
-    if (p_ao != NULL)
+    if (check_active_object_has_handleable_event(p_ao))
     {
-        evf_critical_section_enter();
-        struct Evf_event * p_event = evf_event_queue_pop_front(&p_ao->event_queue);
-        evf_critical_section_exit();
-
-        enum Evf_status status = p_ao->handle_event(p_ao, p_event);
-        destroy_event_reference(p_event);
+        evf_list_append(&ready_lists[p_ao->priority], &p_ao->ready_item);
+    }
+    else
+    {
+        p_ao->is_scheduled = false;
+        num_scheduled_aos--;
     }
-
-    evf_state = EVF_STATE_RUNNING;
 }
 
-bool evf_check_if_work_to_do()
+static uint32_t get_burst_quantum(struct Evf_active_object const * p_ao)
 {
-    return (evf_list_get_length(&priority_scheduling_queue) != 0);
+    return (p_ao->burst_quantum != 0) ? p_ao->burst_quantum : EVF_DEFAULT_BURST_QUANTUM;
 }
+#endif
 
-void evf_register_event_destructor(uint32_t event_type, Evf_event_destructor destructor)
+#if (EVF_SPARSE_EVENT_TYPES_ENABLED == 1)
+static void event_type_index_init()
 {
-    EVF_ASSERT(CHECK_EVENT_TYPE_IS_IN_USER_DEFINED_RANGE(event_type));
-    event_destructors[event_type] = destructor;
+    for (uint32_t i = 0; i < EVF_EVENT_TYPE_INDEX_LENGTH; i++)
+    {
+        event_type_index[i].event_type = EVF_EVENT_TYPE_NULL;
+    }
+    num_indexed_event_types = 0;
+}
+
+/* Event types are often clustered or share low bits (e.g. protocol IDs that are multiples of 
+ * 0x100), so the bits are mixed (MurmurHash3's finaliser) before being reduced to a position.
+ */
+static uint32_t get_event_type_index_position(int32_t event_type)
+{
+    uint32_t hash = (uint32_t)event_type;
+    hash ^= hash >> 16;
+    hash *= 0x85EBCA6Bu;
+    hash ^= hash >> 13;
+    hash *= 0xC2B2AE35u;
+    hash ^= hash >> 16;
+    return hash & (EVF_EVENT_TYPE_INDEX_LENGTH - 1);
+}
+
+/* Returns the index item for the event type, or the empty item where it would be inserted. The 
+ * index is never full (see EVF_EVENT_TYPE_INDEX_LENGTH) so this always terminates.
+ */
+static struct Event_type_index_item * find_event_type_index_item(int32_t event_type)
+{
+    uint32_t position = get_event_type_index_position(event_type);
+    while ((event_type_index[position].event_type != event_type)
+        && (event_type_index[position].event_type != EVF_EVENT_TYPE_NULL))
+    {
+        position = (position + 1) & (EVF_EVENT_TYPE_INDEX_LENGTH - 1);
+    }
+
+    return &event_type_index[position];
+}
+#endif
+
+// Returns -1 if the event type has not been added to the index.
+static int32_t get_event_type_index(int32_t event_type)
+{
+#if (EVF_SPARSE_EVENT_TYPES_ENABLED == 1)
+    if (event_type < EVF_USER_EVENT_TYPES_START)
+    {
+        return -1;
+    }
+
+    struct Event_type_index_item const * p_item = find_event_type_index_item(event_type);
+    return (p_item->event_type == event_type) ? p_item->index : -1;
+#else
+    return CHECK_EVENT_TYPE_IS_IN_USER_DEFINED_RANGE(event_type) 
+        ? (event_type - EVF_USER_EVENT_TYPES_START) 
+        : -1;
+#endif
+}
+
+// Returns -1 if the index is full.
+static int32_t add_event_type_to_index(int32_t event_type)
+{
+#if (EVF_SPARSE_EVENT_TYPES_ENABLED == 1)
+    EVF_ASSERT(event_type >= EVF_USER_EVENT_TYPES_START);
+
+    struct Event_type_index_item * p_item = find_event_type_index_item(event_type);
+    if (p_item->event_type == EVF_EVENT_TYPE_NULL)
+    {
+        if (num_indexed_event_types == EVF_MAX_NUM_USER_DEFINED_EVENT_TYPES)
+        {
+            return -1;
+        }
+        p_item->event_type = event_type;
+        p_item->index = num_indexed_event_types++;
+    }
+
+    return p_item->index;
+#else
+    return get_event_type_index(event_type);
+#endif
+}
+
+#if (EVF_STATIC_TOPOLOGY_ENABLED == 1)
+static uint32_t get_num_registered_aos()
+{
+    return evf_static_registry_length;
+}
+
+/* Checks the things about the static topology that can't be checked at compile time. This costs
+ * nothing when assertions are disabled.
+ */
+static void check_static_topology()
+{
+#if (EVF_ASSERTIONS_ENABLED == 1)
+    for (uint32_t i = 0; i < evf_static_registry_length; i++)
+    {
+        EVF_ASSERT(registered_aos[i] != NULL);
+        EVF_ASSERT(registered_aos[i]->priority <= EVF_ACTIVE_OBJECT_PRIORITY_MAX);
+    }
+
+    for (uint32_t event_type = 0; event_type < EVF_MAX_NUM_USER_DEFINED_EVENT_TYPES; event_type++)
+    {
+        struct Evf_static_subscription_table_item const * p_item = &subscription_table[event_type];
+        if (p_item->p_subscribers == NULL) { continue; } // Not listed.
+
+        // The subscriber list must be NULL-terminated (see evf_topology.h).
+        EVF_ASSERT(p_item->p_subscribers[p_item->num_subscribers] == NULL);
+        for (uint32_t i = 0; i < p_item->num_subscribers; i++)
+        {
+            // Every subscriber must also be listed as an active object.
+            EVF_ASSERT(evf_get_active_object_index(p_item->p_subscribers[i]) != -1);
+        }
+    }
+#endif
+}
+#else
+static uint32_t get_num_registered_aos()
+{
+    return num_registered_aos;
+}
+
+static void subscription_table_init()
+{
+    for (uint32_t event_type = 0; event_type < EVF_MAX_NUM_USER_DEFINED_EVENT_TYPES; event_type++)
+    {
+#if (EVF_COMPACT_MEMORY_ENABLED == 1)
+        for (uint32_t i = 0; i < NUM_SUBSCRIBER_BITSET_WORDS; i++)
+        {
+            subscription_table[event_type].subscriber_bitset[i] = 0;
+        }
+#else
+        subscription_table[event_type].num_subscribers = 0;
+#endif
+    }
+}
+
+#endif
+
+static void event_type_destructors_init()
+{
+    for (uint32_t event_type = 0; event_type < EVF_MAX_NUM_USER_DEFINED_EVENT_TYPES; event_type++)
+    {
+        event_destructors[event_type] = NULL;
+    }
+}
+
+#if (EVF_STATIC_TOPOLOGY_ENABLED == 0)
+static void add_event_subscriber(int32_t event_type, struct Evf_active_object * p_ao)
+{
+    int32_t event_type_index = add_event_type_to_index(event_type);
+    EVF_ASSERT(event_type_index != -1);
+    struct Subscription_table_item * p_item = &subscription_table[event_type_index];
+#if (EVF_COMPACT_MEMORY_ENABLED == 1)
+    int32_t ao_index = evf_get_active_object_index(p_ao);
+    EVF_ASSERT(ao_index != -1);
+    p_item->subscriber_bitset[ao_index / 32] |= (1u << (ao_index % 32));
+#else
+    EVF_ASSERT(p_item->num_subscribers < EVF_MAX_NUM_ACTIVE_OBJECTS);
+    p_item->p_subscribers[p_item->num_subscribers++] = p_ao;
+#endif
+}
+#endif
+
+static void event_internals_init(struct Evf_event * p_event)
+{
+    p_event->ref_count = 0;
+    p_event->flags = 0;
+    p_event->correlation_id = 0;
+    p_event->p_reply_to = NULL;
+}
+
+static void call_event_hook(enum Evf_event_hook_point point,
+                            struct Evf_active_object const * p_ao,
+                            struct Evf_event const * p_event)
+{
+    if (event_hook != NULL) { event_hook(point, p_ao, p_event); }
+}
+
+#if (EVF_SCHEDULING_POLICY == EVF_SCHEDULING_POLICY_EDF)
+static bool post_event_to_active_object_with_deadline(struct Evf_active_object * p_ao,
+                                                      struct Evf_event * p_event,
+                                                      uint64_t deadline_timestamp)
+{
+    if (check_event_is_dropped_on_delivery(p_ao, p_event)) { return true; }
+
+    uint32_t write_index = EVENT_QUEUE_BUFFER_INDEX(p_ao->event_queue_wi);
+
+    bool was_posted = false;
+    if (evf_event_queue_push_back(p_ao, p_event))
+    {
+        p_ao->event_queue.deadline_timestamps[write_index] = deadline_timestamp;
+        p_event->ref_count++;
+        edf_handle_queued_event(p_ao, deadline_timestamp);
+        was_posted = true;
+    }
+
+    return was_posted;
+}
+#endif
+
+static bool post_event_to_active_object(struct Evf_active_object * p_ao, struct Evf_event * p_event)
+{
+#if (EVF_SCHEDULING_POLICY == EVF_SCHEDULING_POLICY_EDF)
+    return post_event_to_active_object_with_deadline(p_ao, p_event, get_default_deadline_timestamp(p_ao));
+#else
+    if (check_event_is_dropped_on_delivery(p_ao, p_event)) { return true; }
+
+    bool was_posted = false;
+    if (evf_event_queue_push_back(p_ao, p_event))
+    {
+        p_event->ref_count++;
+        if (check_active_object_has_handleable_event(p_ao)) { schedule_active_object(p_ao); }
+        was_posted = true;
+    }
+
+    return was_posted;
+#endif
+}
+
+static void destroy_event_reference(struct Evf_event * p_event)
+{
+    /* The reference count is shared with the contexts that post events (and that check if static 
+     * events are still in use), so it must be updated in a critical section.
+     */
+    evf_critical_section_enter();
+    p_event->ref_count--;
+    bool was_last_reference = (p_event->ref_count == 0);
+    evf_critical_section_exit();
+
+    if (was_last_reference && ((p_event->flags & EVENT_FLAG_STATIC) == 0))
+    {
+        int32_t event_type_index = get_event_type_index(p_event->type);
+        if (event_type_index != -1)
+        {
+            Evf_event_destructor dtor = event_destructors[event_type_index];
+            if (dtor != NULL) { dtor(p_event); }
+        }
+        evf_free(p_event);
+    }
+}
+
+/* evf_post and the like hold a reference to the event while posting it (as evf_publish does), so 
+ * that an event that is dropped on delivery (see check_event_is_dropped_on_delivery) is destroyed.
+ * An event that could not be posted is left to the caller, as if the reference was never taken.
+ */
+static void release_posting_reference(struct Evf_event * p_event, bool was_posted)
+{
+    if (was_posted) { destroy_event_reference(p_event); }
+    else { p_event->ref_count = 0; }
+}
+
+static void deliver_published_event(struct Evf_active_object * p_publisher,
+                                    struct Evf_active_object * p_receiver,
+                                    struct Evf_event * p_event)
+{
+    // Published events don't go to the active object that is doing the publishing.
+    if (p_receiver == p_publisher)
+    {
+        return;
+    }
+
+    /* Events may be posted from (other) ISRs/threads so we need to protect each post 
+     * from pre-emption.
+     */
+    evf_critical_section_enter();
+    post_event_to_active_object(p_receiver, p_event);
+    evf_critical_section_exit();
+}
+
+/* The caller must hold a reference to the event for the duration, otherwise a subscriber on 
+ * another thread could handle (and free) the event before it has been delivered to the rest.
+ */
+static void publish_event_to_subscribers(struct Evf_active_object * p_publisher, struct Evf_event * p_event)
+{
+    evf_critical_section_enter();
+    call_event_hook(EVF_EVENT_HOOK_POINT_PUBLISH, p_publisher, p_event);
+    evf_critical_section_exit();
+
+    // Event types that nothing subscribed to may not be in the index.
+    int32_t event_type_index = get_event_type_index(p_event->type);
+    if (event_type_index == -1)
+    {
+        return;
+    }
+
+#if (EVF_STATIC_TOPOLOGY_ENABLED == 0) && (EVF_COMPACT_MEMORY_ENABLED == 1)
+    // Subscribers are delivered to in order of active object index i.e. registration order.
+    struct Subscription_table_item const * p_item = &subscription_table[event_type_index];
+    for (uint32_t word_index = 0; word_index < NUM_SUBSCRIBER_BITSET_WORDS; word_index++)
+    {
+        uint32_t bits = p_item->subscriber_bitset[word_index];
+        for (uint32_t bit_index = 0; bits != 0; bit_index++, bits >>= 1)
+        {
+            if ((bits & 1u) != 0)
+            {
+                deliver_published_event(p_publisher, registered_aos[(word_index * 32) + bit_index], p_event);
+            }
+        }
+    }
+#else
+#if (EVF_STATIC_TOPOLOGY_ENABLED == 1)
+    struct Evf_static_subscription_table_item const * p_item = &subscription_table[event_type_index];
+#else
+    struct Subscription_table_item const * p_item = &subscription_table[event_type_index];
+#endif
+    for (uint32_t i = 0; i < p_item->num_subscribers; i++)
+    {
+        deliver_published_event(p_publisher, p_item->p_subscribers[i], p_event);
+    }
+#endif
+}
+
+#if (EVF_ISR_PUBLISH_ENABLED == 1)
+static void isr_deferral_ring_init()
+{
+    for (uint32_t i = 0; i < EVF_ISR_DEFERRAL_RING_LENGTH; i++)
+    {
+        atomic_init(&isr_deferral_ring[i].sequence, i);
+        isr_deferral_ring[i].p_event = NULL;
+    }
+    atomic_init(&isr_deferral_ring_write_position, 0);
+    isr_deferral_ring_read_position = 0;
+}
+
+static bool isr_deferral_ring_push(struct Evf_event * p_event)
+{
+    uint_fast32_t position = atomic_load_explicit(&isr_deferral_ring_write_position, 
+                                                  memory_order_relaxed);
+    struct Isr_deferral_ring_slot * p_slot;
+    while (true)
+    {
+        p_slot = &isr_deferral_ring[ISR_DEFERRAL_RING_INDEX(position)];
+        uint_fast32_t sequence = atomic_load_explicit(&p_slot->sequence, memory_order_acquire);
+        int32_t difference = (int32_t)(sequence - position);
+        if (difference == 0)
+        {
+            // The slot is free, claim it (unless another producer got there first).
+            if (atomic_compare_exchange_weak_explicit(&isr_deferral_ring_write_position,
+                                                      &position,
+                                                      position + 1,
+                                                      memory_order_relaxed,
+                                                      memory_order_relaxed))
+            {
+                break;
+            }
+        }
+        else if (difference < 0)
+        {
+            // The consumer has not taken the event that was written a lap ago, the ring is full.
+            return false;
+        }
+        else
+        {
+            position = atomic_load_explicit(&isr_deferral_ring_write_position, memory_order_relaxed);
+        }
+    }
+
+    p_slot->p_event = p_event;
+    atomic_store_explicit(&p_slot->sequence, position + 1, memory_order_release);
+    return true;
+}
+
+static bool check_isr_deferral_ring_is_empty()
+{
+    uint_fast32_t position = isr_deferral_ring_read_position;
+    struct Isr_deferral_ring_slot const * p_slot = &isr_deferral_ring[ISR_DEFERRAL_RING_INDEX(position)];
+    return atomic_load_explicit(&p_slot->sequence, memory_order_acquire) != (position + 1);
+}
+
+/* Publishes the deferred events, at most one ring's worth so that ISRs that keep publishing can't
+ * starve the active objects.
+ */
+static void drain_isr_deferral_ring()
+{
+    for (uint32_t i = 0; i < EVF_ISR_DEFERRAL_RING_LENGTH; i++)
+    {
+        uint_fast32_t position = isr_deferral_ring_read_position;
+        struct Isr_deferral_ring_slot * p_slot = &isr_deferral_ring[ISR_DEFERRAL_RING_INDEX(position)];
+        if (atomic_load_explicit(&p_slot->sequence, memory_order_acquire) != (position + 1))
+        {
+            break;
+        }
+
+        struct Evf_event * p_event = p_slot->p_event;
+        atomic_store_explicit(&p_slot->sequence, 
+                              position + EVF_ISR_DEFERRAL_RING_LENGTH, 
+                              memory_order_release);
+        isr_deferral_ring_read_position = position + 1;
+
+        // The ring's reference (taken by evf_publish_from_isr) is held while publishing.
+        publish_event_to_subscribers(NULL, p_event);
+        destroy_event_reference(p_event);
+    }
+}
+#endif
+
+static void timer_handler_callback();
+
+/* Timers that finish within each other's slack windows are grouped together so that they are all
+ * handled by a single callback. The callback is scheduled for the latest time that is still within
+ * the slack window of every timer in the group. Returns -1 if there are no running timers.
+ */
+static int64_t get_coalesced_timer_callback_timestamp()
+{
+    struct Evf_list_item * p_curr_item = running_timers_list.p_head;
+    struct Evf_timer * p_curr_timer = CONTAINER_OF(p_curr_item, struct Evf_timer, item);
+    if (p_curr_timer == NULL)
+    {
+        return -1;
+    }
+
+    int64_t callback_timestamp = p_curr_timer->finish_timestamp + p_curr_timer->slack_ms;
+    while ((p_curr_item = p_curr_item->p_next) != NULL)
+    {
+        p_curr_timer = CONTAINER_OF(p_curr_item, struct Evf_timer, item);
+
+        // Since running timers list is sorted by increasing finish time...
+        if (p_curr_timer->finish_timestamp > callback_timestamp) { break; }
+
+        int64_t latest_timestamp = p_curr_timer->finish_timestamp + p_curr_timer->slack_ms;
+        if (latest_timestamp < callback_timestamp) { callback_timestamp = latest_timestamp; }
+    }
+
+    return callback_timestamp;
+}
+
+static void handle_timer_handler_callback_scheduling()
+{
+    /* Only reprogram the port's callback when the timestamp actually changes e.g. starting a timer
+     * that fits within the slack windows of the current group costs nothing.
+     */
+    int64_t callback_timestamp = get_coalesced_timer_callback_timestamp();
+    if (callback_timestamp == scheduled_timer_callback_timestamp)
+    {
+        return;
+    }
+
+    scheduled_timer_callback_timestamp = callback_timestamp;
+    if (callback_timestamp != -1)
+    {
+        evf_schedule_callback((uint64_t)callback_timestamp, &timer_handler_callback);
+    }
+    else // There is no next to finish so no reason to have a callback scheduled...
+    {
+        evf_cancel_scheduled_callback();
+    }
+}
+
+static void running_timers_list_insert_timer(struct Evf_timer * p_timer)
+{
+    // Running timers list is sorted in order of increasing finish time.
+    struct Evf_list_item * p_curr_item = running_timers_list.p_head;
+    while ((p_curr_item != NULL)
+        && (CONTAINER_OF(p_curr_item, struct Evf_timer, item)->finish_timestamp <= p_timer->finish_timestamp))
+    {
+        p_curr_item = p_curr_item->p_next;
+    }
+
+    if (p_curr_item == NULL) { evf_list_append(&running_timers_list, &p_timer->item); }
+    else { evf_list_insert_before(&running_timers_list, &p_timer->item, p_curr_item); }
+}
+
+static void running_timers_list_add_timer(struct Evf_timer * p_timer)
+{
+    running_timers_list_insert_timer(p_timer);
+
+    // Any timer can change the callback timestamp of its group, not just the next to finish.
+    handle_timer_handler_callback_scheduling();
+}
+
+static void running_timers_list_remove_timer(struct Evf_timer * p_timer)
+{
+    evf_list_remove_item(&running_timers_list, &p_timer->item);
+    p_timer->finish_timestamp = -1;
+    handle_timer_handler_callback_scheduling();
+}
+
+static void post_timer_finished_event(struct Evf_timer * p_timer, uint32_t num_expirations)
+{
+    struct Evf_active_object * p_owner = (struct Evf_active_object *)p_timer->p_owner;
+    struct Evf_event_timer_finished * p_event = &p_timer->finished_event;
+
+    /* The event is embedded in the timer, so if the previous one is still waiting to be handled
+     * then it can only be posted again as is (one event per expiration). Otherwise the expirations
+     * are carried over to the next event.
+     */
+    bool is_in_use = (p_event->base.ref_count != 0);
+    if (is_in_use && p_timer->is_periodic
+        && (p_timer->catch_up_policy != EVF_TIMER_CATCH_UP_POLICY_FIRE_ALL))
+    {
+        if (p_timer->catch_up_policy == EVF_TIMER_CATCH_UP_POLICY_COALESCE)
+        {
+            p_timer->num_unreported_expirations += num_expirations;
+        }
+        return;
+    }
+
+    if (!is_in_use)
+    {
+        p_event->num_expirations = num_expirations + p_timer->num_unreported_expirations;
+        p_timer->num_unreported_expirations = 0;
+    }
+
+    call_event_hook(EVF_EVENT_HOOK_POINT_TIMER_FINISHED, p_owner, &p_event->base);
+    post_event_to_active_object(p_owner, &p_event->base);
+}
+
+static void pending_requests_init()
+{
+    for (uint32_t i = 0; i < EVF_MAX_NUM_PENDING_REQUESTS; i++)
+    {
+        pending_requests[i].is_awaiting_reply = false;
+        pending_requests[i].timer.finished_event.base.ref_count = 0;
+    }
+    next_correlation_id = 1;
+}
+
+static uint32_t take_next_correlation_id()
+{
+    uint32_t correlation_id = next_correlation_id++;
+
+    // 0 means that an event is not part of a request.
+    if (next_correlation_id == 0) { next_correlation_id = 1; }
+
+    return correlation_id;
+}
+
+// Returns NULL if there are no free slots. Must be called in a critical section.
+static struct Pending_request * take_free_pending_request(struct Evf_active_object * p_requester,
+                                                          uint32_t correlation_id,
+                                                          uint32_t timeout_ms)
+{
+    for (uint32_t i = 0; i < EVF_MAX_NUM_PENDING_REQUESTS; i++)
+    {
+        struct Pending_request * p_request = &pending_requests[i];
+        if (p_request->is_awaiting_reply || (p_request->timer.finished_event.base.ref_count != 0))
+        {
+            continue;
+        }
+
+        // The timer's fields are const, since user timers are configured once, so it is copied in.
+        struct Evf_timer const timer = {
+            .p_owner = p_requester,
+            .timer_id = EVF_TIMER_ID_REQUEST_TIMEOUT,
+            .time_ms = timeout_ms,
+        };
+        memcpy(&p_request->timer, &timer, sizeof(timer));
+        evf_timer_init(&p_request->timer);
+        p_request->timer.finished_event.base.type = EVF_EVENT_TYPE_REQUEST_TIMEOUT;
+        p_request->timer.finished_event.base.correlation_id = correlation_id;
+        p_request->correlation_id = correlation_id;
+        p_request->is_awaiting_reply = true;
+        return p_request;
+    }
+
+    return NULL;
+}
+
+/* Returns false if the request is no longer awaiting a reply (i.e. it timed out). Must be called
+ * in a critical section.
+ */
+static bool complete_pending_request(uint32_t correlation_id)
+{
+    for (uint32_t i = 0; i < EVF_MAX_NUM_PENDING_REQUESTS; i++)
+    {
+        struct Pending_request * p_request = &pending_requests[i];
+        if (p_request->is_awaiting_reply && (p_request->correlation_id == correlation_id))
+        {
+            p_request->is_awaiting_reply = false;
+            if (p_request->timer.finish_timestamp != -1)
+            {
+                running_timers_list_remove_timer(&p_request->timer);
+            }
+            return true;
+        }
+    }
+
+    return false;
+}
+
+static void handle_request_timeout(struct Evf_timer * p_timer)
+{
+    struct Pending_request * p_request = CONTAINER_OF(p_timer, struct Pending_request, timer);
+    struct Evf_active_object * p_requester = (struct Evf_active_object *)p_timer->p_owner;
+
+    p_request->is_awaiting_reply = false;
+    call_event_hook(EVF_EVENT_HOOK_POINT_POST, p_requester, &p_timer->finished_event.base);
+    post_event_to_active_object(p_requester, &p_timer->finished_event.base);
+}
+
+static void handle_finished_timer(struct Evf_timer * p_timer, int64_t now)
+{
+    if (p_timer->timer_id == EVF_TIMER_ID_REQUEST_TIMEOUT)
+    {
+        p_timer->finish_timestamp = -1;
+        handle_request_timeout(p_timer);
+        return;
+    }
+
+    uint32_t num_expirations = 1;
+
+    if (p_timer->is_periodic)
+    {
+        // Re-armed from the previous deadline, rather than from now, so that the period does not drift.
+        int64_t period = (int64_t)p_timer->time_ms;
+        int64_t num_missed_periods = (now - p_timer->finish_timestamp) / period;
+        if (p_timer->catch_up_policy == EVF_TIMER_CATCH_UP_POLICY_FIRE_ALL)
+        {
+            // Any missed periods will finish again within the same timer handler callback pass.
+            num_missed_periods = 0;
+        }
+        else if (p_timer->catch_up_policy == EVF_TIMER_CATCH_UP_POLICY_COALESCE)
+        {
+            num_expirations += (uint32_t)num_missed_periods;
+        }
+
+        p_timer->finish_timestamp += (num_missed_periods + 1) * period;
+        running_timers_list_insert_timer(p_timer);
+    }
+    else
+    {
+        p_timer->finish_timestamp = -1;
+    }
+
+    post_timer_finished_event(p_timer, num_expirations);
+}
+
+static void start_timer(struct Evf_timer * p_timer, uint64_t time_ms)
+{
+    EVF_ASSERT(p_timer->p_owner != NULL);
+
+    evf_critical_section_enter();
+
+    if (p_timer->finish_timestamp != -1)
+    {
+        evf_list_remove_item(&running_timers_list, &p_timer->item);
+    }
+    p_timer->finish_timestamp = (int64_t)(evf_get_timestamp_ms() + time_ms);
+    running_timers_list_add_timer(p_timer);
+
+    evf_critical_section_exit();
+}
+
+static void timer_handler_callback()
+{
+    evf_critical_section_enter();
+
+    // The callback that was scheduled is the one being handled now.
+    scheduled_timer_callback_timestamp = -1;
+
+    /* Every timer of the coalesced group (see get_coalesced_timer_callback_timestamp) has finished
+     * by now, so they are all handled in this single pass.
+     */
+    int64_t now = (int64_t)evf_get_timestamp_ms();
+    struct Evf_timer * p_timer;
+    while (((p_timer = CONTAINER_OF(running_timers_list.p_head, struct Evf_timer, item)) != NULL)
+        && (p_timer->finish_timestamp <= now))
+    {
+        evf_list_remove_item(&running_timers_list, &p_timer->item);
+        handle_finished_timer(p_timer, now);
+    }
+
+    handle_timer_handler_callback_scheduling();
+
+    evf_critical_section_exit();
+}
+
+#if (EVF_RTC_BUDGETS_ENABLED == 1)
+static void rtc_step_begin(struct Evf_active_object const * p_ao, struct Evf_event const * p_event)
+{
+    evf_critical_section_enter();
+    current_rtc_step.p_ao = p_ao;
+    current_rtc_step.event_type = p_event->type;
+    current_rtc_step.start_timestamp_us = evf_get_timestamp_us();
+    current_rtc_step.step_number++;
+    is_rtc_step_in_progress = true;
+    evf_critical_section_exit();
+}
+
+static void rtc_step_end(struct Evf_active_object * p_ao, struct Evf_event const * p_event)
+{
+    evf_critical_section_enter();
+    uint64_t duration_us = evf_get_timestamp_us() - current_rtc_step.start_timestamp_us;
+    is_rtc_step_in_progress = false;
+    Evf_rtc_budget_overrun_hook hook = rtc_budget_overrun_hook;
+    evf_critical_section_exit();
+
+    if ((p_ao->rtc_budget_us != 0) && (duration_us > p_ao->rtc_budget_us))
+    {
+        p_ao->num_rtc_budget_overruns++;
+        if (hook != NULL) { hook(p_ao, p_event, duration_us); }
+    }
+}
+#endif
+
+// A single run-to-completion step i.e. the active object handling one event.
+static void run_rtc_step(struct Evf_active_object * p_ao, struct Evf_event * p_event)
+{
+#if (EVF_RTC_BUDGETS_ENABLED == 1)
+    rtc_step_begin(p_ao, p_event);
+#endif
+    p_ao->handle_event(p_ao, p_event);
+#if (EVF_RTC_BUDGETS_ENABLED == 1)
+    rtc_step_end(p_ao, p_event);
+#endif
+}
+
+static void active_object_internals_init(struct Evf_active_object * p_ao)
+{
+    evf_event_queue_init(p_ao);
+    evf_list_item_init(&p_ao->ready_item);
+    p_ao->is_scheduled = false;
+    p_ao->num_rtc_budget_overruns = 0;
+    p_ao->num_deadline_misses = 0;
+#if (EVF_SCHEDULING_POLICY == EVF_SCHEDULING_POLICY_EDF)
+    p_ao->edf_heap_position = 0;
+#endif
+#if (EVF_COROUTINES_ENABLED == 1)
+    p_ao->is_awaiting = false;
+#endif
+}
+
+// Destroys the events that are still queued, returning the active objects to their initial state.
+static void discard_queued_events()
+{
+    for (uint32_t i = 0; i < get_num_registered_aos(); i++)
+    {
+        struct Evf_active_object * p_ao = registered_aos[i];
+        struct Evf_event * p_event;
+        while ((p_event = evf_event_queue_pop_front(p_ao)) != NULL)
+        {
+            destroy_event_reference(p_event);
+        }
+        active_object_internals_init(p_ao);
+    }
+
+#if (EVF_ISR_PUBLISH_ENABLED == 1)
+    // The ring itself is reset by evf_init.
+    while (!check_isr_deferral_ring_is_empty())
+    {
+        uint_fast32_t position = isr_deferral_ring_read_position++;
+        destroy_event_reference(isr_deferral_ring[ISR_DEFERRAL_RING_INDEX(position)].p_event);
+    }
+#endif
+}
+
+// Stops the running timers (including the ones backing pending requests) without handling them.
+static void stop_running_timers()
+{
+    struct Evf_timer * p_timer;
+    while ((p_timer = CONTAINER_OF(running_timers_list.p_head, struct Evf_timer, item)) != NULL)
+    {
+        evf_list_remove_item(&running_timers_list, &p_timer->item);
+        p_timer->finish_timestamp = -1;
+    }
+    scheduled_timer_callback_timestamp = -1;
+    evf_cancel_scheduled_callback();
+}
+
+#if (EVF_STATIC_TOPOLOGY_ENABLED == 0)
+static void add_active_object_to_registered_array(struct Evf_active_object * p_ao)
+{
+    EVF_ASSERT(num_registered_aos < EVF_MAX_NUM_ACTIVE_OBJECTS);
+    registered_aos[num_registered_aos++] = p_ao;
+}
+
+static void register_active_object_event_type_subscriptions(struct Evf_active_object * p_ao)
+{
+    int32_t curr_type;
+    for (uint32_t i = 0; (curr_type = p_ao->event_type_subscriptions[i]) != EVF_EVENT_TYPE_NULL; i++)
+    {
+        EVF_ASSERT(i < EVF_ACTIVE_OBJECT_MAX_NUM_SUBSCRIPTIONS);
+        EVF_ASSERT(CHECK_EVENT_TYPE_IS_IN_USER_DEFINED_RANGE(curr_type));
+        add_event_subscriber(p_ao->event_type_subscriptions[i], p_ao);    
+    }
+}
+#endif
+
+/**************************************************************************************************
+ * EVF API function implementations
+ *************************************************************************************************/
+
+void evf_init()
+{
+    EVF_ASSERT(evf_state == EVF_STATE_UNINIT);
+#if (EVF_STATIC_TOPOLOGY_ENABLED == 1)
+    // The statically declared active objects' internals are valid when zero-initialised.
+    check_static_topology();
+#else
+    num_registered_aos = 0;
+    subscription_table_init();
+#endif
+    event_hook = NULL;
+#if (EVF_RTC_BUDGETS_ENABLED == 1)
+    rtc_budget_overrun_hook = NULL;
+    is_rtc_step_in_progress = false;
+#endif
+#if (EVF_SCHEDULING_POLICY == EVF_SCHEDULING_POLICY_EDF)
+    edf_ready_heap_length = 0;
+    deadline_miss_hook = NULL;
+#else
+    ready_lists_init();
+#endif
+#if (EVF_SPARSE_EVENT_TYPES_ENABLED == 1)
+    event_type_index_init();
+#endif
+    event_type_destructors_init();
+    pending_requests_init();
+#if (EVF_ISR_PUBLISH_ENABLED == 1)
+    isr_deferral_ring_init();
+#endif
+    evf_list_init(&running_timers_list);
+    scheduled_timer_callback_timestamp = -1;
+    evf_state = EVF_STATE_INIT_NOT_RUNNING;
+}
+
+void evf_deinit()
+{
+    if (evf_state == EVF_STATE_UNINIT) { return; }
+
+    evf_critical_section_enter();
+    stop_running_timers();
+    discard_queued_events();
+    evf_state = EVF_STATE_UNINIT;
+    evf_critical_section_exit();
+}
+
+#if (EVF_STATIC_TOPOLOGY_ENABLED == 0)
+void evf_register_active_object(struct Evf_active_object * p_ao)
+{
+    EVF_ASSERT(evf_state == EVF_STATE_INIT_NOT_RUNNING);
+    EVF_ASSERT(p_ao != NULL);
+    EVF_ASSERT(p_ao->priority <= EVF_ACTIVE_OBJECT_PRIORITY_MAX);
+
+    add_active_object_to_registered_array(p_ao);
+    register_active_object_event_type_subscriptions(p_ao);
+    active_object_internals_init(p_ao);
+}
+#endif
+
+void evf_publish(struct Evf_active_object * p_publisher, struct Evf_event * p_event)
+{
+    EVF_ASSERT(p_event != NULL);
+    EVF_ASSERT(check_evf_state_allows_active_objects_to_receive_events());
+
+    event_internals_init(p_event);
+
+    // The publisher's reference, released once the event has been delivered to every subscriber.
+    p_event->ref_count = 1;
+    publish_event_to_subscribers(p_publisher, p_event);
+    destroy_event_reference(p_event);
+};
+
+bool evf_post(struct Evf_active_object * p_receiver, struct Evf_event * p_event)
+{
+    EVF_ASSERT(check_evf_state_allows_active_objects_to_receive_events());
+    EVF_ASSERT(p_receiver != NULL);
+    EVF_ASSERT(p_event != NULL);
+    EVF_ASSERT(CHECK_EVENT_TYPE_IS_IN_USER_DEFINED_RANGE(p_event->type));
+
+    event_internals_init(p_event);
+    p_event->ref_count = 1; // See release_posting_reference.
+
+    evf_critical_section_enter();
+    call_event_hook(EVF_EVENT_HOOK_POINT_POST, p_receiver, p_event);
+    bool okay = post_event_to_active_object(p_receiver, p_event);
+    evf_critical_section_exit();
+
+    release_posting_reference(p_event, okay);
+    return okay;
+};
+
+void evf_event_init_static(void * p_event, int32_t type)
+{
+    EVF_ASSERT(p_event != NULL);
+
+    struct Evf_event * p_evf_event = (struct Evf_event *)p_event;
+    event_internals_init(p_evf_event);
+    p_evf_event->type = type;
+    p_evf_event->flags = EVENT_FLAG_STATIC;
+}
+
+bool evf_event_check_is_in_use(void const * p_event)
+{
+    EVF_ASSERT(p_event != NULL);
+
+    // The reference count only goes back to 0 when the last reference has been destroyed.
+    return (*(volatile uint32_t const *)&((struct Evf_event const *)p_event)->ref_count != 0);
+}
+
+bool evf_post_static(struct Evf_active_object * p_receiver, struct Evf_event * p_event)
+{
+    EVF_ASSERT(check_evf_state_allows_active_objects_to_receive_events());
+    EVF_ASSERT(p_receiver != NULL);
+    EVF_ASSERT(p_event != NULL);
+    EVF_ASSERT((p_event->flags & EVENT_FLAG_STATIC) != 0);
+    EVF_ASSERT(!evf_event_check_is_in_use(p_event));
+
+    evf_critical_section_enter();
+    call_event_hook(EVF_EVENT_HOOK_POINT_POST, p_receiver, p_event);
+    bool okay = post_event_to_active_object(p_receiver, p_event);
+    evf_critical_section_exit();
+
+    return okay;
+}
+
+#if (EVF_ISR_PUBLISH_ENABLED == 1)
+bool evf_publish_from_isr(struct Evf_event * p_event)
+{
+    EVF_ASSERT(p_event != NULL);
+    EVF_ASSERT((p_event->flags & EVENT_FLAG_STATIC) != 0);
+    EVF_ASSERT(CHECK_EVENT_TYPE_IS_IN_USER_DEFINED_RANGE(p_event->type));
+    EVF_ASSERT(!evf_event_check_is_in_use(p_event));
+
+    // Nothing else refers to the event, so its reference count can be written without a lock.
+    p_event->ref_count = 1;
+    if (!isr_deferral_ring_push(p_event))
+    {
+        p_event->ref_count = 0;
+        return false;
+    }
+
+    evf_notify_from_isr();
+    return true;
+}
+#endif
+
+uint32_t evf_request(struct Evf_active_object * p_target, 
+                     struct Evf_event * p_event,
+                     struct Evf_active_object * p_reply_to,
+                     uint32_t timeout_ms)
+{
+    EVF_ASSERT(check_evf_state_allows_active_objects_to_receive_events());
+    EVF_ASSERT(p_target != NULL);
+    EVF_ASSERT(p_event != NULL);
+    EVF_ASSERT(CHECK_EVENT_TYPE_IS_IN_USER_DEFINED_RANGE(p_event->type));
+    EVF_ASSERT(p_reply_to != NULL);
+
+    event_internals_init(p_event);
+    p_event->p_reply_to = p_reply_to;
+    p_event->ref_count = 1; // See release_posting_reference.
+
+    evf_critical_section_enter();
+
+    uint32_t correlation_id = take_next_correlation_id();
+    p_event->correlation_id = correlation_id;
+
+    struct Pending_request * p_pending_request = NULL;
+    if (timeout_ms != 0)
+    {
+        p_pending_request = take_free_pending_request(p_reply_to, correlation_id, timeout_ms);
+        if (p_pending_request == NULL) { correlation_id = 0; }
+        p_event->flags |= EVENT_FLAG_REQUEST_HAS_TIMEOUT;
+    }
+
+    if (correlation_id != 0)
+    {
+        call_event_hook(EVF_EVENT_HOOK_POINT_POST, p_target, p_event);
+        if (!post_event_to_active_object(p_target, p_event))
+        {
+            if (p_pending_request != NULL) { p_pending_request->is_awaiting_reply = false; }
+            correlation_id = 0;
+        }
+        else if (p_pending_request != NULL)
+        {
+            struct Evf_timer * p_timer = &p_pending_request->timer;
+            p_timer->finish_timestamp = (int64_t)(evf_get_timestamp_ms() + p_timer->time_ms);
+            running_timers_list_add_timer(p_timer);
+        }
+    }
+
+    evf_critical_section_exit();
+
+    release_posting_reference(p_event, correlation_id != 0);
+    return correlation_id;
+}
+
+bool evf_reply(struct Evf_event const * p_request, struct Evf_event * p_reply)
+{
+    EVF_ASSERT(check_evf_state_allows_active_objects_to_receive_events());
+    EVF_ASSERT(p_request != NULL);
+    EVF_ASSERT(p_request->p_reply_to != NULL); // Only events sent by evf_request can be replied to.
+    EVF_ASSERT(p_reply != NULL);
+
+    event_internals_init(p_reply);
+    p_reply->correlation_id = p_request->correlation_id;
+    p_reply->ref_count = 1; // See release_posting_reference.
+
+    evf_critical_section_enter();
+
+    bool okay = false;
+    bool is_awaited = ((p_request->flags & EVENT_FLAG_REQUEST_HAS_TIMEOUT) == 0)
+                   || complete_pending_request(p_request->correlation_id);
+    if (is_awaited)
+    {
+        call_event_hook(EVF_EVENT_HOOK_POINT_POST, p_request->p_reply_to, p_reply);
+        okay = post_event_to_active_object(p_request->p_reply_to, p_reply);
+    }
+
+    evf_critical_section_exit();
+
+    release_posting_reference(p_reply, okay);
+    return okay;
+}
+
+#if (EVF_SCHEDULING_POLICY == EVF_SCHEDULING_POLICY_EDF)
+bool evf_post_with_deadline(struct Evf_active_object * p_receiver, 
+                            struct Evf_event * p_event,
+                            uint32_t deadline_ms)
+{
+    EVF_ASSERT(check_evf_state_allows_active_objects_to_receive_events());
+    EVF_ASSERT(p_receiver != NULL);
+    EVF_ASSERT(p_event != NULL);
+    EVF_ASSERT(CHECK_EVENT_TYPE_IS_IN_USER_DEFINED_RANGE(p_event->type));
+
+    event_internals_init(p_event);
+    p_event->ref_count = 1; // See release_posting_reference.
+
+    evf_critical_section_enter();
+    call_event_hook(EVF_EVENT_HOOK_POINT_POST, p_receiver, p_event);
+    bool okay = post_event_to_active_object_with_deadline(p_receiver,
+                                                          p_event,
+                                                          evf_get_timestamp_ms() + deadline_ms);
+    evf_critical_section_exit();
+
+    release_posting_reference(p_event, okay);
+    return okay;
+}
+#endif
+
+#if (EVF_COROUTINES_ENABLED == 1)
+void evf_await(struct Evf_active_object * p_ao, int32_t event_type, uint32_t timer_id)
+{
+    EVF_ASSERT(p_ao != NULL);
+
+    // Posting contexts check the await to decide whether to schedule the active object.
+    evf_critical_section_enter();
+    p_ao->is_awaiting = true;
+    p_ao->awaited_event_type = event_type;
+    p_ao->awaited_timer_id = timer_id;
+    evf_critical_section_exit();
+}
+#endif
+
+void evf_timer_init(struct Evf_timer * p_timer)
+{
+    // -1 indicates that the timer is not running i.e. not in the running timers list.
+    p_timer->finish_timestamp = -1;
+    evf_list_item_init(&p_timer->item);
+    p_timer->num_unreported_expirations = 0;
+
+    struct Evf_event_timer_finished * p_event = &p_timer->finished_event;
+    evf_event_set_type(p_event, EVF_EVENT_TYPE_TIMER_FINISHED);
+    event_internals_init(&p_event->base);
+    p_event->base.flags = EVENT_FLAG_STATIC;
+    p_event->timer_id = p_timer->timer_id;
+    p_event->num_expirations = 1;
+}
+
+void evf_timer_start(struct Evf_timer * p_timer)
+{
+    EVF_ASSERT(p_timer != NULL);
+    EVF_ASSERT(!p_timer->is_periodic || (p_timer->time_ms > 0));
+
+    start_timer(p_timer, p_timer->time_ms);
+}
+
+void evf_timer_start_after(struct Evf_timer * p_timer, uint64_t time_ms)
+{
+    EVF_ASSERT(p_timer != NULL);
+    EVF_ASSERT(!p_timer->is_periodic);
+
+    start_timer(p_timer, time_ms);
+}
+
+void evf_timer_stop(struct Evf_timer * p_timer)
+{
+    EVF_ASSERT(p_timer != NULL);
+
+    evf_critical_section_enter();
+
+    if (p_timer->finish_timestamp != -1)
+    {
+        running_timers_list_remove_timer(p_timer);
+    }
+
+    evf_critical_section_exit();
+}
+
+enum Evf_status evf_task()
+{
+    /* The state is only ever written by the evf_task context, so it can be read here without a
+     * lock, but it is written in a critical section since other contexts read it.
+     */
+    if (evf_state != EVF_STATE_RUNNING)
+    {
+        evf_critical_section_enter();
+        evf_state = EVF_STATE_RUNNING;
+        evf_critical_section_exit();
+    }
+
+#if (EVF_ISR_PUBLISH_ENABLED == 1)
+    drain_isr_deferral_ring();
+#endif
+
+#if (EVF_SCHEDULING_POLICY == EVF_SCHEDULING_POLICY_EDF)
+    struct Evf_active_object * p_ao = NULL;
+    uint64_t deadline_timestamp = 0;
+
+    evf_critical_section_enter();
+    struct Evf_event * p_event = take_next_scheduled_event(&p_ao, &deadline_timestamp);
+    evf_critical_section_exit();
+
+    if (p_event != NULL)
+    {
+        // Events that the active object would ignore are dropped without a run-to-completion step.
+        if (check_active_object_accepts_event(p_ao, p_event))
+        {
+            run_rtc_step(p_ao, p_event);
+            check_for_deadline_miss(p_ao, p_event, deadline_timestamp);
+        }
+
+        evf_critical_section_enter();
+        edf_reschedule_active_object(p_ao);
+        evf_critical_section_exit();
+
+        destroy_event_reference(p_event);
+    }
+#else
+    evf_critical_section_enter();
+    struct Evf_active_object * p_ao = take_next_scheduled_active_object();
+    evf_critical_section_exit();
+
+    if (p_ao != NULL)
+    {
+        // The burst is cut short if a higher priority active object becomes ready.
+        uint32_t burst_quantum = get_burst_quantum(p_ao);
+        for (uint32_t i = 0; i < burst_quantum; i++)
+        {
+            evf_critical_section_enter();
+            struct Evf_event * p_event = NULL;
+            Evf_queue_index index;
+            if (((i == 0) || !check_if_higher_priority_active_object_is_ready(p_ao->priority))
+                && find_next_handleable_event(p_ao, &index))
+            {
+                p_event = take_handleable_event(p_ao, index);
+            }
+            evf_critical_section_exit();
+
+            if (p_event == NULL) { break; }
+
+            // Events that the active object would ignore are dropped without a run-to-completion step.
+            if (check_active_object_accepts_event(p_ao, p_event)) { run_rtc_step(p_ao, p_event); }
+            destroy_event_reference(p_event);
+        }
+
+        evf_critical_section_enter();
+        reschedule_active_object(p_ao);
+        evf_critical_section_exit();
+    }
+#endif
+
+    return EVF_STATUS_RUNNING;
+}
+
+bool evf_check_if_work_to_do()
+{
+#if (EVF_ISR_PUBLISH_ENABLED == 1)
+    if (!check_isr_deferral_ring_is_empty()) { return true; }
+#endif
+
+#if (EVF_SCHEDULING_POLICY == EVF_SCHEDULING_POLICY_EDF)
+    return (edf_ready_heap_length != 0);
+#else
+    return (num_scheduled_aos != 0);
+#endif
+}
+
+enum Evf_next_wakeup evf_get_next_wakeup(uint64_t * p_wakeup_timestamp_ms)
+{
+    EVF_ASSERT(p_wakeup_timestamp_ms != NULL);
+
+    enum Evf_next_wakeup next_wakeup = EVF_NEXT_WAKEUP_NONE;
+
+    evf_critical_section_enter();
+    if (evf_check_if_work_to_do())
+    {
+        next_wakeup = EVF_NEXT_WAKEUP_NOW;
+    }
+    else if (scheduled_timer_callback_timestamp != -1)
+    {
+        *p_wakeup_timestamp_ms = (uint64_t)scheduled_timer_callback_timestamp;
+        next_wakeup = EVF_NEXT_WAKEUP_AT_TIMESTAMP;
+    }
+    evf_critical_section_exit();
+
+    return next_wakeup;
+}
+
+void evf_register_event_destructor(uint32_t event_type, Evf_event_destructor destructor)
+{
+    EVF_ASSERT(evf_state == EVF_STATE_INIT_NOT_RUNNING);
+    EVF_ASSERT(CHECK_EVENT_TYPE_IS_IN_USER_DEFINED_RANGE((int32_t)event_type));
+
+    int32_t event_type_index = add_event_type_to_index((int32_t)event_type);
+    EVF_ASSERT(event_type_index != -1);
+    event_destructors[event_type_index] = destructor;
+}
+
+int32_t evf_register_event_type(int32_t event_type)
+{
+    EVF_ASSERT(evf_state == EVF_STATE_INIT_NOT_RUNNING);
+    EVF_ASSERT(CHECK_EVENT_TYPE_IS_IN_USER_DEFINED_RANGE(event_type));
+    return add_event_type_to_index(event_type);
+}
+
+int32_t evf_get_event_type_index(int32_t event_type)
+{
+    return get_event_type_index(event_type);
 }
 
 void evf_event_set_type(void * p_event, uint32_t type)
@@ -455,5 +1856,64 @@ void evf_event_set_type(void * p_event, uint32_t type)
     p_evf_event->type = type;
 }
 
+void evf_register_event_hook(Evf_event_hook hook)
+{
+    evf_critical_section_enter();
+    event_hook = hook;
+    evf_critical_section_exit();
+}
+
+int32_t evf_get_active_object_index(struct Evf_active_object const * p_ao)
+{
+    for (uint32_t i = 0; i < get_num_registered_aos(); i++)
+    {
+        if (registered_aos[i] == p_ao) { return (int32_t)i; }
+    }
+
+    return -1;
+}
+
+struct Evf_active_object * evf_get_active_object_by_index(uint32_t index)
+{
+    return (index < get_num_registered_aos()) ? registered_aos[index] : NULL;
+}
+
+#if (EVF_RTC_BUDGETS_ENABLED == 1)
+void evf_register_rtc_budget_overrun_hook(Evf_rtc_budget_overrun_hook hook)
+{
+    evf_critical_section_enter();
+    rtc_budget_overrun_hook = hook;
+    evf_critical_section_exit();
+}
+
+uint32_t evf_get_num_rtc_budget_overruns(struct Evf_active_object const * p_ao)
+{
+    EVF_ASSERT(p_ao != NULL);
+    return p_ao->num_rtc_budget_overruns;
+}
+
+bool evf_get_current_rtc_step(struct Evf_rtc_step_info * p_info)
+{
+    EVF_ASSERT(p_info != NULL);
+
+    evf_critical_section_enter();
+    bool is_in_progress = is_rtc_step_in_progress;
+    if (is_in_progress) { *p_info = current_rtc_step; }
+    evf_critical_section_exit();
+
+    return is_in_progress;
+}
+#endif
 
+#if (EVF_SCHEDULING_POLICY == EVF_SCHEDULING_POLICY_EDF)
+void evf_register_deadline_miss_hook(Evf_deadline_miss_hook hook)
+{
+    deadline_miss_hook = hook;
+}
 
+uint32_t evf_get_num_deadline_misses(struct Evf_active_object const * p_ao)
+{
+    EVF_ASSERT(p_ao != NULL);
+    return p_ao->num_deadline_misses;
+}
+#endif
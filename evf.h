@@ -13,14 +13,42 @@
 #define EVF_MAX_NUM_ACTIVE_OBJECTS    32
 #endif 
 
+/* With EVF_SPARSE_EVENT_TYPES_ENABLED this is the maximum number of distinct user-defined event
+ * types in use, rather than the maximum event type.
+ */
 #ifndef EVF_MAX_NUM_USER_DEFINED_EVENT_TYPES
 #define EVF_MAX_NUM_USER_DEFINED_EVENT_TYPES   32
 #endif
 
+/* When enabled, user-defined event types can be any non-negative 32-bit value (e.g. protocol IDs),
+ * rather than having to be sequential. The types that are in use are mapped to dense indices by 
+ * an open-addressing hash index with EVF_EVENT_TYPE_INDEX_LENGTH entries, which is built as the 
+ * active objects (and destructors) are registered, so lookups stay O(1). Not compatible with 
+ * EVF_STATIC_TOPOLOGY_ENABLED or the HSM layer, whose tables are indexed by event type directly.
+ */
+#ifndef EVF_SPARSE_EVENT_TYPES_ENABLED
+#define EVF_SPARSE_EVENT_TYPES_ENABLED    0
+#endif
+
+// Must be a power of 2 and larger than EVF_MAX_NUM_USER_DEFINED_EVENT_TYPES (ideally double).
+#ifndef EVF_EVENT_TYPE_INDEX_LENGTH
+#define EVF_EVENT_TYPE_INDEX_LENGTH    (2 * EVF_MAX_NUM_USER_DEFINED_EVENT_TYPES)
+#endif
+
+#if ((EVF_EVENT_TYPE_INDEX_LENGTH & (EVF_EVENT_TYPE_INDEX_LENGTH - 1)) != 0) \
+    || (EVF_EVENT_TYPE_INDEX_LENGTH <= EVF_MAX_NUM_USER_DEFINED_EVENT_TYPES)
+#error "EVF_EVENT_TYPE_INDEX_LENGTH must be a power of 2 larger than EVF_MAX_NUM_USER_DEFINED_EVENT_TYPES"
+#endif
+
+// Must be a power of 2.
 #ifndef EVF_EVENT_QUEUE_LENGTH   
 #define EVF_EVENT_QUEUE_LENGTH   16
 #endif 
 
+#if ((EVF_EVENT_QUEUE_LENGTH & (EVF_EVENT_QUEUE_LENGTH - 1)) != 0)
+#error "EVF_EVENT_QUEUE_LENGTH must be a power of 2"
+#endif
+
 #ifndef EVF_ACTIVE_OBJECT_MAX_NAME_LENGTH
 #define EVF_ACTIVE_OBJECT_MAX_NAME_LENGTH    32
 #endif
@@ -37,12 +65,133 @@
 #define EVF_SHUTDOWN_TIME_MS    5000
 #endif
 
+/* When enabled, each active object's run-to-completion steps are timed against its rtc_budget_us
+ * (see Evf_active_object). Requires the port to implement evf_get_timestamp_us.
+ */
+#ifndef EVF_RTC_BUDGETS_ENABLED
+#define EVF_RTC_BUDGETS_ENABLED    0
+#endif
+
+/* The scheduling policy decides which active object gets to handle an event next.
+ * - Fixed priority: by the active objects' (static) priority fields.
+ * - Earliest deadline first (EDF): by the earliest absolute deadline of the events in each active
+ *   object's queue. An event's deadline is relative to when it was posted, either given by 
+ *   evf_post_with_deadline or the receiver's default_deadline_ms. Note: events are still handled
+ *   in order within an active object, so the events in front of an urgent one inherit its 
+ *   deadline (they have to be handled before it).
+ */
+#define EVF_SCHEDULING_POLICY_FIXED_PRIORITY    0
+#define EVF_SCHEDULING_POLICY_EDF               1
+
+#ifndef EVF_SCHEDULING_POLICY
+#define EVF_SCHEDULING_POLICY    EVF_SCHEDULING_POLICY_FIXED_PRIORITY
+#endif
+
+/* With the fixed priority scheduling policy, an active object that gets scheduled handles up to its
+ * burst quantum of queued events in a row (unless a higher priority active object becomes ready).
+ * Active objects of the same priority take turns, so the quantum is also their weight in a 
+ * weighted round-robin. Larger quanta improve throughput (better cache locality) at the cost of 
+ * latency for the other active objects of the same priority. This is the quantum used for active
+ * objects that have a burst_quantum of 0.
+ */
+#ifndef EVF_DEFAULT_BURST_QUANTUM
+#define EVF_DEFAULT_BURST_QUANTUM    1
+#endif
+
+// Used for active objects that have a default_deadline_ms of 0.
+#ifndef EVF_DEFAULT_DEADLINE_MS
+#define EVF_DEFAULT_DEADLINE_MS    1000
+#endif
+
+/* Compact memory mode, for small-RAM builds:
+ * - The event queue indices are 8-bit (16-bit for queues longer than 128 events), rather than 
+ *   32-bit. Note: the queues still have to hold event pointers.
+ * - Each event type's subscribers are stored as a bitset of active object indices (see 
+ *   evf_get_active_object_index), rather than an array of active object pointers.
+ * See evf_ram_usage for the RAM that the EVF's state uses in a given configuration (the ram_usage 
+ * target in tests/Makefile prints it at build time).
+ */
+#ifndef EVF_COMPACT_MEMORY_ENABLED
+#define EVF_COMPACT_MEMORY_ENABLED    0
+#endif
+
+#if (EVF_COMPACT_MEMORY_ENABLED == 1) && (EVF_EVENT_QUEUE_LENGTH <= 128)
+typedef uint8_t Evf_queue_index;
+#elif (EVF_COMPACT_MEMORY_ENABLED == 1) && (EVF_EVENT_QUEUE_LENGTH <= 32768)
+typedef uint16_t Evf_queue_index;
+#else
+typedef uint32_t Evf_queue_index;
+#endif
+
+/* When enabled, the active objects and their subscriptions are declared once, at compile time, 
+ * and the subscription table and active object registry are generated as const tables (see 
+ * evf_topology.h). There is then nothing to build at start up and evf_register_active_object is 
+ * not available. The active objects' event_type_subscriptions fields are not used.
+ */
+#ifndef EVF_STATIC_TOPOLOGY_ENABLED
+#define EVF_STATIC_TOPOLOGY_ENABLED    0
+#endif
+
+#if (EVF_STATIC_TOPOLOGY_ENABLED == 1) && (EVF_SPARSE_EVENT_TYPES_ENABLED == 1)
+#error "EVF_STATIC_TOPOLOGY_ENABLED and EVF_SPARSE_EVENT_TYPES_ENABLED can't be used together"
+#endif
+
+/* When enabled, events can be published from ISRs and signal handlers with evf_publish_from_isr.
+ * Such publishes are deferred through a lock-free ring of EVF_ISR_DEFERRAL_RING_LENGTH events, 
+ * which evf_task drains. Requires lock-free C11 atomics and the port to implement 
+ * evf_notify_from_isr.
+ */
+#ifndef EVF_ISR_PUBLISH_ENABLED
+#define EVF_ISR_PUBLISH_ENABLED    0
+#endif
+
+// Must be a power of 2.
+#ifndef EVF_ISR_DEFERRAL_RING_LENGTH
+#define EVF_ISR_DEFERRAL_RING_LENGTH    16
+#endif
+
+#if ((EVF_ISR_DEFERRAL_RING_LENGTH & (EVF_ISR_DEFERRAL_RING_LENGTH - 1)) != 0)
+#error "EVF_ISR_DEFERRAL_RING_LENGTH must be a power of 2"
+#endif
+
+/* When enabled, an active object can await a single event type and/or timer (see evf_await), and
+ * any other events are deferred (left queued) until the await has ended. This is what the 
+ * coroutine layer (see evf_coroutine.h) is built on.
+ */
+#ifndef EVF_COROUTINES_ENABLED
+#define EVF_COROUTINES_ENABLED    0
+#endif
+
+// The maximum number of requests (see evf_request) with a timeout that can be awaiting replies.
+#ifndef EVF_MAX_NUM_PENDING_REQUESTS
+#define EVF_MAX_NUM_PENDING_REQUESTS    8
+#endif
+
 // EVF-defined event types.
-#define EVF_EVENT_TYPE_NULL              -3
+#define EVF_EVENT_TYPE_NULL              -4
+#define EVF_EVENT_TYPE_REQUEST_TIMEOUT   -3
 #define EVF_EVENT_TYPE_SHUTDOWN_PENDING  -2
 #define EVF_EVENT_TYPE_TIMER_FINISHED    -1
 
-// User-defined event types must be sequential, starting at this number (inclusive).
+// The number of EVF-defined event types, not including EVF_EVENT_TYPE_NULL.
+#define EVF_NUM_EVF_DEFINED_EVENT_TYPES   3
+
+/* Event types that are defined by ports (e.g. see port/evf_port_linux.h) are taken from this range,
+ * [EVF_PORT_EVENT_TYPES_START, EVF_PORT_EVENT_TYPES_START + EVF_MAX_NUM_PORT_EVENT_TYPES), so that
+ * adding them never changes the values of the EVF-defined event types (e.g. in recorded logs).
+ */
+#define EVF_PORT_EVENT_TYPES_START      -1024
+#define EVF_MAX_NUM_PORT_EVENT_TYPES    64
+
+// Reserved for the timers that back request timeouts, user timers must not use this ID.
+#define EVF_TIMER_ID_REQUEST_TIMEOUT    UINT32_MAX
+
+// Reserved for the timers that back coroutine timeouts (see evf_coroutine.h).
+#define EVF_TIMER_ID_COROUTINE_TIMEOUT    (UINT32_MAX - 1)
+
+/* User-defined event types must be sequential, starting at this number (inclusive), unless 
+ * EVF_SPARSE_EVENT_TYPES_ENABLED is 1 in which case they only have to be at least this number.
+ */
 #define EVF_USER_EVENT_TYPES_START  0
 
 /* A convenient macro to use when allocating events. For example...
@@ -56,6 +205,14 @@ enum Evf_status
     EVF_STATUS_SHUTDOWN,
 };
 
+// See evf_get_next_wakeup.
+enum Evf_next_wakeup
+{
+    EVF_NEXT_WAKEUP_NOW,           // There are events waiting to be handled.
+    EVF_NEXT_WAKEUP_AT_TIMESTAMP,  // No events waiting, but a timer is running.
+    EVF_NEXT_WAKEUP_NONE,          // No events waiting and no timers running.
+};
+
 enum Evf_active_object_status
 {
     EVF_ACTIVE_OBJECT_STATUS_RUNNING,
@@ -66,18 +223,24 @@ enum Evf_active_object_status
 struct Evf_active_object;
 struct Evf_event;
 
-// Event queue (implemented as a circular buffer).
+/* Event queue (implemented as a circular buffer). Its read and write indices are kept in struct
+ * Evf_active_object, with the other small fields, so that they are not padded out to the alignment
+ * of the event pointers. The indices are free-running, i.e. they are only wrapped when indexing the
+ * buffer, so that the number in the queue is wi - ri and a full queue is told apart from an empty
+ * one without keeping a separate count. Like the rest of the EVF's state, the queue is only 
+ * accessed within the EVF critical section.
+ */
 struct Evf_event_queue
 {
     struct Evf_event * p_event_buffer[EVF_EVENT_QUEUE_LENGTH];
-    uint32_t ri;
-    uint32_t wi;
-    uint32_t num_in_queue;
+#if (EVF_SCHEDULING_POLICY == EVF_SCHEDULING_POLICY_EDF)
+    uint64_t deadline_timestamps[EVF_EVENT_QUEUE_LENGTH];
+#endif
 };
 
 
-/* The 'base class' for events. The type field is set by the user, whereas the ref_count field
- * is strictly for EVF-internal usage. Embed an instance of this struct as the first member of
+/* The 'base class' for events. The type field is set by the user, whereas the ref_count and flags
+ * fields are strictly for EVF-internal usage. Embed an instance of this struct as the first member of
  * any user-defined ('derived class') events. For example...
  * struct My_custom_event
  * {
@@ -88,7 +251,7 @@ struct Evf_event_queue
  * The type field is what you will ultimately use in your active object event handlers in order to
  * cast the Evf_events back to the custom 'derived' class type. Therefore before post/publishing an
  * event you must set the type. Note: all defined types must be sequential starting from 
- * EVF_USER_EVENT_TYPES_START.
+ * EVF_USER_EVENT_TYPES_START (unless EVF_SPARSE_EVENT_TYPES_ENABLED is 1).
  * 
  * struct My_custom_event * p_event = evf_malloc(sizeof(struct My_custom_event));
  * p_event->base.type = EVENT_TYPE_MY_CUSTOM_EVENT;
@@ -101,13 +264,44 @@ struct Evf_event
 {
     int32_t type; 
     uint32_t ref_count;
+    uint32_t flags;
+
+    /* Set by evf_request/evf_reply, the correlation ID is the same for a request, its reply and its
+     * timeout event (see EVF_EVENT_TYPE_REQUEST_TIMEOUT), and 0 for any other event. It may be 
+     * read by the user, but p_reply_to is for EVF-internal use only.
+     */
+    uint32_t correlation_id;
+    struct Evf_active_object * p_reply_to;
 };
 
-// This type of event is posted to an active object when one of its timer's (see Evf_timer) finishes.
+/* This type of event is posted to an active object when one of its timer's (see Evf_timer) finishes.
+ * These events are embedded in the timers themselves, so finishing a timer never allocates.
+ */
 struct Evf_event_timer_finished
 {
     struct Evf_event base; // The type is EVF_EVENT_TYPE_TIMER_FINISHED.
     uint32_t timer_id;
+
+    /* The number of timer periods that this event accounts for. Always 1, except for periodic
+     * timers using EVF_TIMER_CATCH_UP_POLICY_COALESCE that have missed periods.
+     */
+    uint32_t num_expirations;
+};
+
+/* What a periodic timer does when it is handled late enough that one or more periods have been 
+ * missed, e.g. when a long run-to-completion step delayed the timer handling. The timer is always
+ * re-armed from its previous deadline (not from 'now') so the period never drifts.
+ */
+enum Evf_timer_catch_up_policy
+{
+    // A single event with num_expirations set to the number of periods that have passed.
+    EVF_TIMER_CATCH_UP_POLICY_COALESCE,
+
+    // An event for every period that has passed.
+    EVF_TIMER_CATCH_UP_POLICY_FIRE_ALL,
+
+    // A single event, the missed periods are dropped.
+    EVF_TIMER_CATCH_UP_POLICY_SKIP,
 };
 
 /* p_self is a pointer to the active object that the handler belongs to. To access instance specific
@@ -132,9 +326,51 @@ struct Evf_event_timer_finished
 typedef enum Evf_active_object_status (*Evf_event_handler)(struct Evf_active_object * p_self,
                                                            struct Evf_event const * p_event);
 
+/* Checks if an active object handles an event in its current state. See the accepts_event field of
+ * Evf_active_object.
+ */
+typedef bool (*Evf_event_filter)(struct Evf_active_object const * p_self,
+                                 struct Evf_event const * p_event);
+
 // See evf_register_event_destructor for more information.
 typedef void (*Evf_event_destructor)(struct Evf_event * p_event);
 
+// The points at which a registered event hook is called. See evf_register_event_hook.
+enum Evf_event_hook_point
+{
+    EVF_EVENT_HOOK_POINT_POST,
+    EVF_EVENT_HOOK_POINT_PUBLISH,
+    EVF_EVENT_HOOK_POINT_TIMER_FINISHED,
+};
+
+// See evf_register_rtc_budget_overrun_hook.
+typedef void (*Evf_rtc_budget_overrun_hook)(struct Evf_active_object const * p_ao,
+                                            struct Evf_event const * p_event,
+                                            uint64_t duration_us);
+
+// See evf_register_deadline_miss_hook.
+typedef void (*Evf_deadline_miss_hook)(struct Evf_active_object const * p_ao,
+                                       struct Evf_event const * p_event,
+                                       uint64_t lateness_ms);
+
+// Describes the run-to-completion step that is currently in progress, see evf_get_current_rtc_step.
+struct Evf_rtc_step_info
+{
+    struct Evf_active_object const * p_ao;
+    int32_t event_type;
+    uint64_t start_timestamp_us;
+
+    // Incremented for every step, so that observers can tell consecutive steps apart.
+    uint32_t step_number;
+};
+
+/* p_ao is the receiver for posts and timer events, and the publisher (possibly NULL) for 
+ * publishes. See evf_register_event_hook for more information. 
+ */
+typedef void (*Evf_event_hook)(enum Evf_event_hook_point point,
+                               struct Evf_active_object const * p_ao,
+                               struct Evf_event const * p_event);
+
 /* The 'base class' for active objects. When defining your own active objects you must embed an  
  * instance of this struct as the first member. For example...
  * struct Adc_reader_active_object
@@ -162,20 +398,74 @@ typedef void (*Evf_event_destructor)(struct Evf_event * p_event);
  */
 struct Evf_active_object
 {
-    /*
-     *
+    /* The fields are ordered so that the ones used when dispatching events come first and share as
+     * few cache lines as possible, with the configuration and statistics that are rarely used at
+     * the end.
      */
-    char const name[EVF_ACTIVE_OBJECT_MAX_NAME_LENGTH+1];
+
+    /* When the active object gets scheduled by the EVF, an event is taken from the front of the
+     * event queue and passed to the handle_event function. This is how all event handling is done.
+     */
+    Evf_event_handler const handle_event;
+
+    /* Optional (NULL means that every event is handled). Returns false for the events that the 
+     * active object would ignore in its current state, which the EVF then drops without a 
+     * run-to-completion step: they are not queued at all if the active object is idle (not 
+     * scheduled and with an empty queue), otherwise they are dropped when taken from the queue. It
+     * is never called while the active object is handling an event, and it may be called from
+     * within a critical section so it must be quick. For example, see evf_hsm_accepts_event.
+     */
+    Evf_event_filter const accepts_event;
 
     /* Priority level (0 is the maximum priority) affect scheduling. A higher priority active 
-     * object will be scheduled before any lower priority active object
+     * object will be scheduled before any lower priority active object. Only used with the fixed
+     * priority scheduling policy (see EVF_SCHEDULING_POLICY).
      */
     uint8_t const priority; 
 
-    /* When the active object gets scheduled by the EVF, an event is taken from the front of the
-     * event queue and passed to the handle_event function. This is how all event handling is done.
+    /* The maximum number of queued events handled in a row each time the active object is 
+     * scheduled. 0 means EVF_DEFAULT_BURST_QUANTUM. Only used with the fixed priority scheduling
+     * policy.
      */
-    Evf_event_handler const handle_event;
+    uint8_t const burst_quantum;
+
+    // For EVF-internal use only.
+    bool is_scheduled;
+    Evf_queue_index event_queue_ri; // Read index, advanced when an event is taken.
+    Evf_queue_index event_queue_wi; // Write index, advanced when an event is posted.
+
+    /* The deadline, in milliseconds after being posted/published, for handling events that are 
+     * not given an explicit deadline. 0 means EVF_DEFAULT_DEADLINE_MS. Only used with the EDF 
+     * scheduling policy (see EVF_SCHEDULING_POLICY).
+     */
+    uint32_t const default_deadline_ms;
+
+    /* The longest that a single run-to-completion step (i.e. one handle_event call) is expected 
+     * to take, in microseconds. Since the EVF is cooperative, a step that overruns its budget 
+     * delays every other active object. 0 means no budget. Only used if EVF_RTC_BUDGETS_ENABLED 
+     * is 1, see evf_register_rtc_budget_overrun_hook.
+     */
+    uint32_t const rtc_budget_us;
+
+    // For EVF-internal use only.
+#if (EVF_COROUTINES_ENABLED == 1)
+    bool is_awaiting;
+    int32_t awaited_event_type;
+    uint32_t awaited_timer_id;
+#endif
+#if (EVF_SCHEDULING_POLICY == EVF_SCHEDULING_POLICY_EDF)
+    uint64_t edf_deadline_timestamp;
+    uint32_t edf_heap_position;
+#endif
+    struct Evf_list_item ready_item;
+    struct Evf_event_queue event_queue;
+    uint32_t num_rtc_budget_overruns;
+    uint32_t num_deadline_misses;
+
+    /*
+     *
+     */
+    char const name[EVF_ACTIVE_OBJECT_MAX_NAME_LENGTH+1];
 
     /* When an event of a subscribed event type is published, a reference to that event will be
      * delivered to the active object's event queue (unless it was the one that published it).
@@ -184,9 +474,6 @@ struct Evf_active_object
      * Note: this list must be terminated by EVF_EVENT_TYPE_NULL, even when not in use. 
      */ 
     int32_t const event_type_subscriptions[EVF_ACTIVE_OBJECT_MAX_NUM_SUBSCRIPTIONS+1];
-
-    // For EVF-internal use only.
-    struct Evf_event_queue event_queue;
 };
 
 struct Evf_timer
@@ -197,24 +484,84 @@ struct Evf_timer
     // 
     uint32_t const timer_id;
 
+    // For periodic timers this is the period.
     uint64_t const time_ms;
     bool const is_periodic;
 
+    // Only applies to periodic timers. The default is EVF_TIMER_CATCH_UP_POLICY_COALESCE.
+    enum Evf_timer_catch_up_policy const catch_up_policy;
+
+    /* How many milliseconds late the timer is allowed to finish. Timers whose slack windows
+     * overlap are handled together, with a single wakeup, which reduces the number of wakeups when
+     * many timers finish close together. Leave as 0 for the timer to finish as exactly as possible.
+     */
+    uint32_t const slack_ms;
+
     // For EVF-internal usage only.
     int64_t finish_timestamp;
     struct Evf_list_item item;
+    struct Evf_event_timer_finished finished_event;
+    uint32_t num_unreported_expirations;
+};
+
+#if (EVF_STATIC_TOPOLOGY_ENABLED == 1)
+// For EVF-internal use only, generated by evf_topology.h.
+struct Evf_static_subscription_table_item
+{
+    struct Evf_active_object * const * const p_subscribers;
+    uint32_t const num_subscribers;
+};
+
+extern struct Evf_active_object * const evf_static_registry[];
+extern uint32_t const evf_static_registry_length;
+extern struct Evf_static_subscription_table_item const 
+    evf_static_subscription_table[EVF_MAX_NUM_USER_DEFINED_EVENT_TYPES];
+#endif
+
+/* The RAM used by the EVF's state, in bytes, as sized by the configuration at build time (see 
+ * evf_ram_usage). The active objects and timers are allocated by the application, so only their 
+ * sizes are given.
+ */
+struct Evf_ram_usage
+{
+    uint32_t active_object_bytes;      // Per active object.
+    uint32_t timer_bytes;              // Per timer.
+    uint32_t registry_bytes;           // The registered active objects.
+    uint32_t subscription_table_bytes; // 0 with EVF_STATIC_TOPOLOGY_ENABLED (it is const).
+    uint32_t scheduler_bytes;          // The ready lists, or the EDF ready heap.
+    uint32_t event_destructors_bytes;
+    uint32_t event_type_index_bytes;   // Only used with EVF_SPARSE_EVENT_TYPES_ENABLED.
+    uint32_t pending_requests_bytes;
+    uint32_t isr_deferral_ring_bytes;  // Only used with EVF_ISR_PUBLISH_ENABLED.
+    uint32_t other_bytes;              // Everything else e.g. hooks, counters and state.
+    uint32_t total_bytes;              // The sum of the above, excluding the per-object sizes.
 };
 
+/* Computed at build time, so it can also be read from the binary (e.g. with a debugger) without 
+ * running it. If EVF_RAM_BUDGET_BYTES is defined then exceeding it is a compile error.
+ */
+extern struct Evf_ram_usage const evf_ram_usage;
+
 /**************************************************************************************************
  * Initialises the EVF. Must be done before any other EVF operations.  
  *************************************************************************************************/
 void evf_init();
 
+/**************************************************************************************************
+ * Returns the EVF to its uninitialised state, so that evf_init can be called again e.g. between
+ * tests. The running timers are stopped and the events that have not been handled yet are 
+ * destroyed. Must not be called while evf_task is running, or from an event handler. Does nothing
+ * if the EVF is not initialised.
+ *************************************************************************************************/
+void evf_deinit();
+
+#if (EVF_STATIC_TOPOLOGY_ENABLED == 0)
 /**************************************************************************************************
  * Once an active object is registered it can receive events that it has subscribed to/events that
  * have been posted to it. All registrations must be done prior to calling evf_task.
  *************************************************************************************************/
 void evf_register_active_object(struct Evf_active_object * p_ao);
+#endif
 
 /**************************************************************************************************
  * Publishes an event to all of the registered active objects that are subscribed to the event
@@ -229,6 +576,79 @@ void evf_publish(struct Evf_active_object * p_publisher, struct Evf_event * p_ev
  *************************************************************************************************/
 bool evf_post(struct Evf_active_object * p_receiver, struct Evf_event * p_event);
 
+/**************************************************************************************************
+ * Initialises an event that is statically allocated (or embedded in another object, as timer 
+ * finished events are), for contexts where evf_malloc can't or shouldn't be used e.g. ISRs. Static
+ * events are never freed. Note: static events must only be sent with evf_publish_from_isr or 
+ * evf_post_static, since evf_post/evf_publish re-initialise the event.
+ *************************************************************************************************/
+void evf_event_init_static(void * p_event, int32_t type);
+
+/**************************************************************************************************
+ * Checks if an event is still waiting to be delivered/handled. A static event must not be sent 
+ * again (or modified) while it is in use. Can be called from an ISR or signal handler.
+ *************************************************************************************************/
+bool evf_event_check_is_in_use(void const * p_event);
+
+/**************************************************************************************************
+ * Posts a static event (see evf_event_init_static) directly to the specified active object. May
+ * fail (return false) if the receiver's queue is already full. The event must not be in use.
+ *************************************************************************************************/
+bool evf_post_static(struct Evf_active_object * p_receiver, struct Evf_event * p_event);
+
+#if (EVF_ISR_PUBLISH_ENABLED == 1)
+/**************************************************************************************************
+ * Publishes a static event (see evf_event_init_static) from an ISR or signal handler. This is 
+ * async-signal-safe: the event is only pushed onto a lock-free ring and the publish itself is done
+ * by the next call to evf_task, which drains the ring in a batch. Returns false if the ring is 
+ * full (see EVF_ISR_DEFERRAL_RING_LENGTH). The event must not be in use.
+ *************************************************************************************************/
+bool evf_publish_from_isr(struct Evf_event * p_event);
+#endif
+
+/**************************************************************************************************
+ * Posts a request event to p_target, like evf_post, but tagged so that the target's reply (see 
+ * evf_reply) is posted only to p_reply_to, rather than being published to every subscriber of the
+ * reply type. Returns the request's correlation ID, which its reply will carry, or 0 if the 
+ * request could not be posted.
+ * 
+ * If timeout_ms is not 0 and no reply has been made within timeout_ms milliseconds, an event of 
+ * type EVF_EVENT_TYPE_REQUEST_TIMEOUT, with the same correlation ID, is posted to p_reply_to 
+ * instead and any later reply is dropped. At most EVF_MAX_NUM_PENDING_REQUESTS requests with a 
+ * timeout can be pending at once (0 is returned if there are no free slots).
+ *************************************************************************************************/
+uint32_t evf_request(struct Evf_active_object * p_target, 
+                     struct Evf_event * p_event,
+                     struct Evf_active_object * p_reply_to,
+                     uint32_t timeout_ms);
+
+/**************************************************************************************************
+ * Posts p_reply to the active object that made the request p_request (see evf_request). Returns 
+ * false if the reply could not be posted, either because the requester's queue is full or because
+ * the request has already timed out. As with evf_post, an event that is not posted is not freed.
+ *************************************************************************************************/
+bool evf_reply(struct Evf_event const * p_request, struct Evf_event * p_reply);
+
+/**************************************************************************************************
+ * The same as evf_post, but the event must be handled within deadline_ms milliseconds from now
+ * instead of the receiver's default_deadline_ms. Only available with the EDF scheduling policy.
+ *************************************************************************************************/
+bool evf_post_with_deadline(struct Evf_active_object * p_receiver, 
+                            struct Evf_event * p_event,
+                            uint32_t deadline_ms);
+
+/**************************************************************************************************
+ * Makes p_ao await the next event of type event_type (may be EVF_EVENT_TYPE_NULL) or the next
+ * finished event of its timer with timer_id. Until then, p_ao is only scheduled for those events 
+ * and EVF_EVENT_TYPE_SHUTDOWN_PENDING, which are taken from anywhere in its queue. The await ends 
+ * as soon as one of them is passed to the handler. Any other events are deferred: they stay in 
+ * p_ao's queue, in the order they were posted, and are handled after the await has ended. Note 
+ * that deferred events still take up space in the queue, so if too many arrive while p_ao is 
+ * awaiting, posting the awaited event (or the timer's finished event) fails. Must only be called 
+ * from p_ao's own event handler. Only available if EVF_COROUTINES_ENABLED is 1.
+ *************************************************************************************************/
+void evf_await(struct Evf_active_object * p_ao, int32_t event_type, uint32_t timer_id);
+
 /**************************************************************************************************
  * Timers must be initialised before they are used.
  *************************************************************************************************/
@@ -237,17 +657,24 @@ void evf_timer_init(struct Evf_timer * p_timer);
 /**************************************************************************************************
  * Starts (or restarts if it is already started) a timer. Note: only the pointer is copied, timers
  * must have static lifetime. Note: should be called only in active object code (e.g. not from
- * an ISR).
+ * an ISR). Periodic timers keep running, finishing every time_ms milliseconds, until stopped.
  *************************************************************************************************/
 void evf_timer_start(struct Evf_timer * p_timer);
 
+/**************************************************************************************************
+ * The same as evf_timer_start, but the (non-periodic) timer finishes after time_ms milliseconds 
+ * instead of its own time_ms, for timeouts that vary from one start to the next.
+ *************************************************************************************************/
+void evf_timer_start_after(struct Evf_timer * p_timer, uint64_t time_ms);
+
 /**************************************************************************************************
  * Stops a timer. Has no effect if the timer is not running.
  *************************************************************************************************/
 void evf_timer_stop(struct Evf_timer * p_timer);
 
 /**************************************************************************************************
- * This function must be called in a loop for the active objects to handle events.
+ * This function must be called in a loop for the active objects to handle events. Each call lets
+ * one active object handle its next event(s) (see EVF_DEFAULT_BURST_QUANTUM).
  *************************************************************************************************/
 enum Evf_status evf_task();
 
@@ -272,17 +699,98 @@ void evf_signal_shutdown();
  *************************************************************************************************/
 bool evf_check_if_work_to_do();
 
+/**************************************************************************************************
+ * Combines evf_check_if_work_to_do with a query of the earliest pending timer deadline, atomically,
+ * so that an idle loop knows exactly how long it may sleep for (tickless idle). When the result is
+ * EVF_NEXT_WAKEUP_AT_TIMESTAMP, p_wakeup_timestamp_ms is set to the timestamp (same counter as 
+ * evf_get_timestamp_ms) at which the timer handler callback is scheduled. Note: timer slack is 
+ * already accounted for, so this may be later than the earliest timer's exact finish time.
+ *************************************************************************************************/
+enum Evf_next_wakeup evf_get_next_wakeup(uint64_t * p_wakeup_timestamp_ms);
+
 /**************************************************************************************************
  * Registering a destructor for an event type means that everytime an event of that type is 
  * finished being handled by all of the active objects that were given the event for handling, the
  * EVF will handle the cleanup by using the registered destructor. This is useful if you have 
- * event types that require cleanup e.g. contain pointers to dynamic memory.
+ * event types that require cleanup e.g. contain pointers to dynamic memory. It must be called 
+ * after evf_init and before evf_task is first called.
  *************************************************************************************************/
 void evf_register_event_destructor(uint32_t event_type, Evf_event_destructor destructor);
 
+/**************************************************************************************************
+ * User-defined event types are mapped to dense indices in [0, EVF_MAX_NUM_USER_DEFINED_EVENT_TYPES),
+ * which can be used to index per-type tables (e.g. see port/evf_record_linux.c). Without 
+ * EVF_SPARSE_EVENT_TYPES_ENABLED the index is just the offset from EVF_USER_EVENT_TYPES_START.
+ * 
+ * evf_register_event_type adds an event type to the index (the types that active objects 
+ * subscribe to, or that have destructors, are added automatically). It must be called after 
+ * evf_init and before evf_task is first called. Returns the event type's index, or -1 if the 
+ * index is full.
+ * 
+ * evf_get_event_type_index returns the index of an event type, or -1 if it was never added.
+ *************************************************************************************************/
+int32_t evf_register_event_type(int32_t event_type);
+int32_t evf_get_event_type_index(int32_t event_type);
+
 /**************************************************************************************************
  * 
  *************************************************************************************************/
 void evf_event_set_type(void * p_event, uint32_t type);
 
+/**************************************************************************************************
+ * Registers a hook that is called every time an event enters the EVF i.e. when it is posted, when
+ * it is published (once, before it is delivered to the subscribers) and when a timer finished 
+ * event is posted to a timer's owner. Only one hook can be registered at a time, use NULL to
+ * de-register it. The hook is called from within a critical section so it must be quick. This is
+ * intended for tracing/recording (see port/evf_record_linux.h).
+ *************************************************************************************************/
+void evf_register_event_hook(Evf_event_hook hook);
+
+/**************************************************************************************************
+ * Active objects are indexed in the order that they were registered (or listed in the static 
+ * topology, see EVF_STATIC_TOPOLOGY_ENABLED). Since registration order is
+ * fixed for a given build, the index can be used to refer to an active object outside of the
+ * running program e.g. in a recorded event log. Returns -1 if the active object is not registered.
+ *************************************************************************************************/
+int32_t evf_get_active_object_index(struct Evf_active_object const * p_ao);
+
+/**************************************************************************************************
+ * The inverse of evf_get_active_object_index. Returns NULL if there is no active object with the
+ * given index.
+ *************************************************************************************************/
+struct Evf_active_object * evf_get_active_object_by_index(uint32_t index);
+
+/**************************************************************************************************
+ * Registers a hook that is called (from evf_task, after the step) every time an active object's
+ * run-to-completion step takes longer than its rtc_budget_us. Use NULL to de-register it. Only 
+ * available if EVF_RTC_BUDGETS_ENABLED is 1.
+ *************************************************************************************************/
+void evf_register_rtc_budget_overrun_hook(Evf_rtc_budget_overrun_hook hook);
+
+/**************************************************************************************************
+ * The number of run-to-completion steps of the active object that have overrun its rtc_budget_us.
+ * Only available if EVF_RTC_BUDGETS_ENABLED is 1.
+ *************************************************************************************************/
+uint32_t evf_get_num_rtc_budget_overruns(struct Evf_active_object const * p_ao);
+
+/**************************************************************************************************
+ * Gets the run-to-completion step that is in progress right now. Returns false if no step is in
+ * progress. Intended to be called from a different context to evf_task, e.g. a watchdog thread,
+ * to detect active objects that are stuck. Only available if EVF_RTC_BUDGETS_ENABLED is 1.
+ *************************************************************************************************/
+bool evf_get_current_rtc_step(struct Evf_rtc_step_info * p_info);
+
+/**************************************************************************************************
+ * Registers a hook that is called (from evf_task, after the step) every time an event is finished
+ * being handled after its deadline. Use NULL to de-register it. Only available with the EDF 
+ * scheduling policy.
+ *************************************************************************************************/
+void evf_register_deadline_miss_hook(Evf_deadline_miss_hook hook);
+
+/**************************************************************************************************
+ * The number of events that the active object finished handling after their deadlines. Only 
+ * available with the EDF scheduling policy.
+ *************************************************************************************************/
+uint32_t evf_get_num_deadline_misses(struct Evf_active_object const * p_ao);
+
 #endif // EVF_H
@@ -0,0 +1,121 @@
+
+#include "evf_coroutine.h"
+#include "port/evf_port.h"
+#include <stddef.h>
+#include <string.h>
+
+#if (EVF_ASSERTIONS_ENABLED == 1)
+#define EVF_ASSERT(condition)   evf_assert(condition)
+#else
+#define EVF_ASSERT(condition)
+#endif
+
+/**************************************************************************************************
+ * Static Functions
+ *************************************************************************************************/
+
+static void stop_timeout(struct Evf_coroutine_active_object * p_co)
+{
+    if (p_co->is_timeout_running)
+    {
+        evf_timer_stop(&p_co->timeout_timer);
+        p_co->is_timeout_running = false;
+    }
+}
+
+/* A finished event of the timeout timer may still be queued after the await that started it has
+ * ended (and the timer was stopped), so only one that arrives at or after the current timeout's
+ * finish time ends the await.
+ */
+static bool check_timeout_has_finished(struct Evf_coroutine_active_object const * p_co)
+{
+    return p_co->is_timeout_running && (evf_get_timestamp_ms() >= p_co->timeout_timestamp_ms);
+}
+
+/**************************************************************************************************
+ * API function implementations
+ *************************************************************************************************/
+
+void evf_coroutine_init(struct Evf_coroutine_active_object * p_co)
+{
+    EVF_ASSERT(p_co != NULL);
+    EVF_ASSERT(p_co->body != NULL);
+    EVF_ASSERT(p_co->base.handle_event == &evf_coroutine_dispatch);
+
+    // The timer's fields are const, since user timers are configured once, so it is copied in.
+    struct Evf_timer const timer = {
+        .p_owner = &p_co->base,
+        .timer_id = EVF_TIMER_ID_COROUTINE_TIMEOUT,
+    };
+    memcpy(&p_co->timeout_timer, &timer, sizeof(timer));
+    evf_timer_init(&p_co->timeout_timer);
+
+    p_co->resume_point = 0;
+    p_co->is_finished = false;
+    p_co->is_timeout_running = false;
+    p_co->has_timed_out = false;
+    p_co->body(p_co, NULL);
+}
+
+enum Evf_active_object_status evf_coroutine_dispatch(struct Evf_active_object * p_self,
+                                                     struct Evf_event const * p_event)
+{
+    struct Evf_coroutine_active_object * p_co = (struct Evf_coroutine_active_object *)p_self;
+    if (p_co->is_finished)
+    {
+        return EVF_ACTIVE_OBJECT_STATUS_SHUTDOWN;
+    }
+
+    if (p_event->type == EVF_EVENT_TYPE_SHUTDOWN_PENDING)
+    {
+        stop_timeout(p_co);
+        p_co->is_finished = true;
+        return EVF_ACTIVE_OBJECT_STATUS_SHUTDOWN;
+    }
+
+    bool is_timeout_event = (p_event->type == EVF_EVENT_TYPE_TIMER_FINISHED)
+        && (((struct Evf_event_timer_finished const *)p_event)->timer_id == EVF_TIMER_ID_COROUTINE_TIMEOUT);
+    if (is_timeout_event && !check_timeout_has_finished(p_co))
+    {
+        // A stale timeout, keep awaiting.
+        evf_await(p_self, p_co->awaited_event_type, EVF_TIMER_ID_COROUTINE_TIMEOUT);
+        return EVF_ACTIVE_OBJECT_STATUS_RUNNING;
+    }
+
+    p_co->has_timed_out = is_timeout_event;
+    if (is_timeout_event)
+    {
+        p_co->is_timeout_running = false;
+    }
+    else
+    {
+        stop_timeout(p_co);
+    }
+
+    return p_co->body(p_co, p_event);
+}
+
+bool evf_coroutine_check_timed_out(struct Evf_coroutine_active_object const * p_co)
+{
+    EVF_ASSERT(p_co != NULL);
+    return p_co->has_timed_out;
+}
+
+void evf_coroutine_await(struct Evf_coroutine_active_object * p_co,
+                         int32_t event_type,
+                         uint32_t timeout_ms)
+{
+    EVF_ASSERT(p_co != NULL);
+    EVF_ASSERT((event_type != EVF_EVENT_TYPE_NULL) || (timeout_ms > 0));
+
+    p_co->awaited_event_type = event_type;
+    if (timeout_ms > 0)
+    {
+        p_co->timeout_timestamp_ms = evf_get_timestamp_ms() + timeout_ms;
+        p_co->is_timeout_running = true;
+        evf_timer_start_after(&p_co->timeout_timer, timeout_ms);
+    }
+
+    // The timeout timer is always let through, so that stale timeouts can be recognised.
+    evf_await(&p_co->base, event_type, EVF_TIMER_ID_COROUTINE_TIMEOUT);
+}
@@ -0,0 +1,142 @@
+/**************************************************************************************************
+ * An optional, stackless (protothread-style) coroutine layer for active objects. Instead of
+ * keeping track of which step of a sequence it is in, along with a timer and matching events by
+ * hand, the active object's behaviour is written as one straight-line function that awaits the
+ * events and timeouts it needs. While it is awaiting, any other events are deferred by the EVF
+ * (see evf_await): they stay queued, in order, until the coroutine awaits them, so no 
+ * run-to-completion steps are spent on them in the meantime. Requires EVF_COROUTINES_ENABLED to
+ * be 1.
+ *
+ * For example, "send, wait up to 50 ms for the ack, retry up to 3 times"...
+ * static enum Evf_active_object_status sender_run(struct Evf_coroutine_active_object * p_self,
+ *                                                 struct Evf_event const * p_event)
+ * {
+ *     struct Sender_active_object * p_sender = (struct Sender_active_object *)p_self;
+ *
+ *     EVF_COROUTINE_BEGIN(p_self);
+ *     for (p_sender->num_attempts = 0; p_sender->num_attempts < 3; p_sender->num_attempts++)
+ *     {
+ *         send_message(p_sender);
+ *         EVF_AWAIT_EVENT_OR_TIMEOUT(p_self, EVENT_TYPE_ACK, 50);
+ *         if (!evf_coroutine_check_timed_out(p_self)) { break; }
+ *     }
+ *     EVF_COROUTINE_END(p_self);
+ * }
+ *
+ * struct Sender_active_object sender_ao = {
+ *     .base = {
+ *         .base = {
+ *             .name         = "Sender",
+ *             .priority     = 2,
+ *             .handle_event = &evf_coroutine_dispatch,
+ *             .event_type_subscriptions = { EVENT_TYPE_ACK, EVF_EVENT_TYPE_NULL },
+ *         },
+ *         .body = &sender_run,
+ *     },
+ * };
+ *
+ * Note: since the coroutine is stackless, local variables do not keep their values across awaits,
+ * so any state must be kept in the active object. Awaits can't be used inside a switch statement
+ * in the body, or in functions called by it.
+ * Note: after an await, p_event is the event that ended it (the awaited event or the timeout's
+ * timer finished event).
+ * Note: on EVF_EVENT_TYPE_SHUTDOWN_PENDING the coroutine is abandoned at whichever await it is at.
+ *************************************************************************************************/
+
+#ifndef EVF_COROUTINE_H
+#define EVF_COROUTINE_H
+
+#include "evf.h"
+#include <stdint.h>
+#include <stdbool.h>
+
+#if (EVF_COROUTINES_ENABLED != 1)
+#error "evf_coroutine.h requires EVF_COROUTINES_ENABLED to be 1"
+#endif
+
+// Forward-declarations.
+struct Evf_coroutine_active_object;
+
+/* The coroutine itself. It is called with a NULL p_event by evf_coroutine_init, and then resumed
+ * with the event that ended each await. Must use EVF_COROUTINE_BEGIN and EVF_COROUTINE_END.
+ */
+typedef enum Evf_active_object_status (*Evf_coroutine_body)(struct Evf_coroutine_active_object * p_self,
+                                                            struct Evf_event const * p_event);
+
+/* The 'base class' for coroutine active objects, embed it as the first member the same way that
+ * struct Evf_active_object is embedded in plain active objects. base.handle_event must be
+ * evf_coroutine_dispatch.
+ */
+struct Evf_coroutine_active_object
+{
+    struct Evf_active_object base;
+
+    Evf_coroutine_body const body;
+
+    // For EVF-internal use only.
+    uint32_t resume_point;
+    bool is_finished;
+    bool is_timeout_running;
+    bool has_timed_out;
+    int32_t awaited_event_type;
+    uint64_t timeout_timestamp_ms;
+    struct Evf_timer timeout_timer;
+};
+
+// Starts the body of the coroutine, must be the first statement in it.
+#define EVF_COROUTINE_BEGIN(p_self) \
+    switch ((p_self)->resume_point) { case 0:
+
+// Ends the body of the coroutine, must be the last statement in it. Reaching it shuts the active object down.
+#define EVF_COROUTINE_END(p_self) \
+    } (p_self)->is_finished = true; return EVF_ACTIVE_OBJECT_STATUS_SHUTDOWN
+
+// Suspends the coroutine until an event of event_type is received.
+#define EVF_AWAIT_EVENT(p_self, event_type) \
+    EVF_COROUTINE_AWAIT(p_self, event_type, 0)
+
+// Suspends the coroutine for timeout_ms milliseconds.
+#define EVF_AWAIT_TIMEOUT(p_self, timeout_ms) \
+    EVF_COROUTINE_AWAIT(p_self, EVF_EVENT_TYPE_NULL, timeout_ms)
+
+/* Suspends the coroutine until an event of event_type is received, or for at most timeout_ms
+ * milliseconds. Use evf_coroutine_check_timed_out to tell which.
+ */
+#define EVF_AWAIT_EVENT_OR_TIMEOUT(p_self, event_type, timeout_ms) \
+    EVF_COROUTINE_AWAIT(p_self, event_type, timeout_ms)
+
+// For EVF-internal use only. The case label is where the body resumes from on the next dispatch.
+#define EVF_COROUTINE_AWAIT(p_self, event_type, timeout_ms)                   \
+    do                                                                        \
+    {                                                                         \
+        evf_coroutine_await((p_self), (event_type), (timeout_ms));            \
+        (p_self)->resume_point = __LINE__;                                    \
+        return EVF_ACTIVE_OBJECT_STATUS_RUNNING;                              \
+        case __LINE__:;                                                       \
+    } while (0)
+
+/**************************************************************************************************
+ * Runs the body of the coroutine up to its first await. Must be done after registering the active
+ * object and before evf_task is called.
+ *************************************************************************************************/
+void evf_coroutine_init(struct Evf_coroutine_active_object * p_co);
+
+/**************************************************************************************************
+ * The event handler for coroutine active objects (see Evf_event_handler).
+ *************************************************************************************************/
+enum Evf_active_object_status evf_coroutine_dispatch(struct Evf_active_object * p_self,
+                                                     struct Evf_event const * p_event);
+
+/**************************************************************************************************
+ * Checks if the last await ended because its timeout finished (rather than the awaited event).
+ *************************************************************************************************/
+bool evf_coroutine_check_timed_out(struct Evf_coroutine_active_object const * p_co);
+
+/**************************************************************************************************
+ * For EVF-internal use only (see EVF_COROUTINE_AWAIT). A timeout_ms of 0 means no timeout.
+ *************************************************************************************************/
+void evf_coroutine_await(struct Evf_coroutine_active_object * p_co,
+                         int32_t event_type,
+                         uint32_t timeout_ms);
+
+#endif // EVF_COROUTINE_H
@@ -0,0 +1,183 @@
+
+#include "evf_hsm.h"
+#include "port/evf_port.h"
+#include <stddef.h>
+
+#if (EVF_ASSERTIONS_ENABLED == 1)
+#define EVF_ASSERT(condition)   evf_assert(condition)
+#else
+#define EVF_ASSERT(condition)  
+#endif
+
+/**************************************************************************************************
+ * Static Functions 
+ *************************************************************************************************/
+
+#define CHECK_EVENT_TYPE_IS_EVF_DEFINED(type) \
+    (((type) >= -EVF_NUM_EVF_DEFINED_EVENT_TYPES) && ((type) < 0))
+
+// Returns -1 if the event type has no transition table entry (see EVF_HSM_ON).
+static int32_t get_transition_table_index(int32_t event_type)
+{
+    if (CHECK_EVENT_TYPE_IS_EVF_DEFINED(event_type))
+    {
+        return event_type + EVF_NUM_EVF_DEFINED_EVENT_TYPES;
+    }
+
+    int32_t event_type_index = evf_get_event_type_index(event_type);
+    return (event_type_index != -1) ? (event_type_index + EVF_NUM_EVF_DEFINED_EVENT_TYPES) : -1;
+}
+
+/* Finds the transition for the event type, starting at p_state and working up through its parents.
+ * Returns NULL (and sets *pp_handling_state to NULL) if no state handles the event type.
+ */
+static struct Evf_hsm_transition const * find_transition(struct Evf_hsm_state const * p_state,
+                                                         int32_t event_type,
+                                                         struct Evf_hsm_state const ** pp_handling_state)
+{
+    *pp_handling_state = NULL;
+    int32_t table_index = get_transition_table_index(event_type);
+    if (table_index == -1)
+    {
+        return NULL;
+    }
+
+    for (; p_state != NULL; p_state = p_state->p_parent)
+    {
+        struct Evf_hsm_transition const * p_transition = &p_state->transitions[table_index];
+        if (p_transition->is_handled)
+        {
+            *pp_handling_state = p_state;
+            return p_transition;
+        }
+    }
+
+    return NULL;
+}
+
+static bool check_state_is_ancestor_or_self(struct Evf_hsm_state const * p_ancestor,
+                                            struct Evf_hsm_state const * p_state)
+{
+    for (; p_state != NULL; p_state = p_state->p_parent)
+    {
+        if (p_state == p_ancestor) { return true; }
+    }
+
+    return false;
+}
+
+/* The state that a transition exits up to (but not including) and enters down from. If the target
+ * is the current state or one of its parents, the target itself is exited and re-entered.
+ */
+static struct Evf_hsm_state const * find_transition_root(struct Evf_hsm_state const * p_current,
+                                                         struct Evf_hsm_state const * p_target)
+{
+    struct Evf_hsm_state const * p_root = p_target->p_parent;
+    while ((p_root != NULL) && !check_state_is_ancestor_or_self(p_root, p_current))
+    {
+        p_root = p_root->p_parent;
+    }
+
+    return p_root;
+}
+
+static void exit_states_up_to(struct Evf_hsm_active_object * p_hsm,
+                              struct Evf_hsm_state const * p_root,
+                              struct Evf_event const * p_event)
+{
+    struct Evf_hsm_state const * p_state = p_hsm->p_current_state;
+    for (; (p_state != NULL) && (p_state != p_root); p_state = p_state->p_parent)
+    {
+        if (p_state->on_exit != NULL) { p_state->on_exit(p_hsm, p_event); }
+    }
+}
+
+// Entry actions are run from the outermost state inwards.
+static void enter_states_down_to(struct Evf_hsm_active_object * p_hsm,
+                                 struct Evf_hsm_state const * p_root,
+                                 struct Evf_hsm_state const * p_target,
+                                 struct Evf_event const * p_event)
+{
+    if ((p_target == NULL) || (p_target == p_root)) { return; }
+
+    enter_states_down_to(p_hsm, p_root, p_target->p_parent, p_event);
+    if (p_target->on_entry != NULL) { p_target->on_entry(p_hsm, p_event); }
+}
+
+// Enters p_target from p_root and then drills down through the initial children.
+static void enter_target_state(struct Evf_hsm_active_object * p_hsm,
+                               struct Evf_hsm_state const * p_root,
+                               struct Evf_hsm_state const * p_target,
+                               struct Evf_event const * p_event)
+{
+    enter_states_down_to(p_hsm, p_root, p_target, p_event);
+    while (p_target->p_initial_child != NULL)
+    {
+        EVF_ASSERT(p_target->p_initial_child->p_parent == p_target);
+        p_target = p_target->p_initial_child;
+        if (p_target->on_entry != NULL) { p_target->on_entry(p_hsm, p_event); }
+    }
+
+    p_hsm->p_current_state = p_target;
+}
+
+/**************************************************************************************************
+ * API function implementations
+ *************************************************************************************************/
+
+void evf_hsm_init(struct Evf_hsm_active_object * p_hsm)
+{
+    EVF_ASSERT(p_hsm != NULL);
+    EVF_ASSERT(p_hsm->p_initial_state != NULL);
+    EVF_ASSERT(p_hsm->base.handle_event == &evf_hsm_dispatch);
+    EVF_ASSERT(p_hsm->base.accepts_event == &evf_hsm_accepts_event);
+
+    p_hsm->p_current_state = NULL;
+    enter_target_state(p_hsm, NULL, p_hsm->p_initial_state, NULL);
+}
+
+enum Evf_active_object_status evf_hsm_dispatch(struct Evf_active_object * p_self,
+                                               struct Evf_event const * p_event)
+{
+    struct Evf_hsm_active_object * p_hsm = (struct Evf_hsm_active_object *)p_self;
+    EVF_ASSERT(p_hsm->p_current_state != NULL);
+
+    struct Evf_hsm_state const * p_handling_state;
+    struct Evf_hsm_transition const * p_transition = find_transition(p_hsm->p_current_state,
+                                                                     p_event->type,
+                                                                     &p_handling_state);
+    // Events that are not handled are dropped by the EVF, see evf_hsm_accepts_event.
+    EVF_ASSERT(p_transition != NULL);
+
+    if (p_transition->p_target == NULL) // Internal transition.
+    {
+        if (p_transition->action != NULL) { p_transition->action(p_hsm, p_event); }
+        return EVF_ACTIVE_OBJECT_STATUS_RUNNING;
+    }
+
+    struct Evf_hsm_state const * p_root = find_transition_root(p_hsm->p_current_state,
+                                                               p_transition->p_target);
+    exit_states_up_to(p_hsm, p_root, p_event);
+    if (p_transition->action != NULL) { p_transition->action(p_hsm, p_event); }
+    enter_target_state(p_hsm, p_root, p_transition->p_target, p_event);
+
+    return p_hsm->p_current_state->is_final ? EVF_ACTIVE_OBJECT_STATUS_SHUTDOWN
+                                            : EVF_ACTIVE_OBJECT_STATUS_RUNNING;
+}
+
+bool evf_hsm_accepts_event(struct Evf_active_object const * p_self, struct Evf_event const * p_event)
+{
+    struct Evf_hsm_active_object const * p_hsm = (struct Evf_hsm_active_object const *)p_self;
+
+    // Events can be posted before evf_hsm_init, they are checked again when taken from the queue.
+    if (p_hsm->p_current_state == NULL) { return true; }
+
+    return evf_hsm_check_if_event_type_is_handled(p_hsm, p_event->type);
+}
+
+bool evf_hsm_check_if_event_type_is_handled(struct Evf_hsm_active_object const * p_hsm, 
+                                            int32_t event_type)
+{
+    struct Evf_hsm_state const * p_handling_state;
+    return (find_transition(p_hsm->p_current_state, event_type, &p_handling_state) != NULL);
+}
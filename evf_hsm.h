@@ -0,0 +1,154 @@
+/**************************************************************************************************
+ * An optional, table-driven hierarchical state machine (HSM) layer for active objects. Instead of
+ * writing an event handler that switches on p_event->type, the states and their transitions are
+ * described by const tables (which can live in read-only memory) and evf_hsm_dispatch is used as
+ * the active object's event handler. Each state has a transition table entry for every event type
+ * (EVF-defined and user-defined), indexed by event type index (see evf_get_event_type_index), so 
+ * looking up a (state, event type) is a single array access. If a state does not handle an event
+ * type then its parent states are tried. The cost is that each state's table takes 
+ * EVF_HSM_TABLE_LENGTH entries, however many event types it handles.
+ *
+ * evf_hsm_accepts_event must be used as the active object's accepts_event filter, so that the EVF 
+ * drops the events that the current state (and its parents) don't handle before they are 
+ * scheduled, i.e. rejected events never cost a run-to-completion step or call any user code.
+ *
+ * Note: since the tables are indexed at compile time, the HSM layer can't be used with 
+ * EVF_SPARSE_EVENT_TYPES_ENABLED, and port event types (see EVF_PORT_EVENT_TYPES_START) are never
+ * handled.
+ *
+ * For example...
+ * static struct Evf_hsm_state const idle_state;
+ * static struct Evf_hsm_state const busy_state;
+ * 
+ * static struct Evf_hsm_state const idle_state = {
+ *     .p_name   = "Idle",
+ *     .on_entry = &motor_stop,
+ *     .transitions = {
+ *         EVF_HSM_ON(EVENT_TYPE_START) = EVF_HSM_TRANSITION(&busy_state, &motor_start),
+ *         EVF_HSM_ON(EVENT_TYPE_STOP)  = EVF_HSM_INTERNAL(&motor_brake),
+ *     },
+ * };
+ * 
+ * struct Motor_active_object motor_ao = {
+ *     .base = {
+ *         .base = {
+ *             .name          = "Motor",
+ *             .priority      = 2,
+ *             .handle_event  = &evf_hsm_dispatch,
+ *             .accepts_event = &evf_hsm_accepts_event,
+ *             .event_type_subscriptions = { EVENT_TYPE_START, EVENT_TYPE_STOP, EVF_EVENT_TYPE_NULL },
+ *         },
+ *         .p_initial_state = &idle_state,
+ *     },
+ * };
+ *************************************************************************************************/
+
+#ifndef EVF_HSM_H
+#define EVF_HSM_H
+
+#include "evf.h"
+#include <stdint.h>
+#include <stdbool.h>
+
+#if (EVF_SPARSE_EVENT_TYPES_ENABLED == 1)
+#error "The HSM layer can't be used with EVF_SPARSE_EVENT_TYPES_ENABLED"
+#endif
+
+// Every state has a transition table entry for every event type (EVF-defined and user-defined).
+#define EVF_HSM_TABLE_LENGTH    (EVF_NUM_EVF_DEFINED_EVENT_TYPES + EVF_MAX_NUM_USER_DEFINED_EVENT_TYPES)
+
+/* Designates the transition table entry for an event type. The EVF-defined event types come first,
+ * followed by the user-defined ones in event type index order.
+ */
+#define EVF_HSM_ON(event_type)    [(event_type) + EVF_NUM_EVF_DEFINED_EVENT_TYPES]
+
+/* A transition to p_target_state (exiting and entering states as required) that calls action_fn
+ * (may be NULL) after the exits and before the entries. A transition to the handling state itself
+ * exits and re-enters it.
+ */
+#define EVF_HSM_TRANSITION(p_target_state, action_fn) \
+    { .is_handled = true, .p_target = (p_target_state), .action = (action_fn) }
+
+// Handles the event by calling action_fn (may be NULL) without changing state.
+#define EVF_HSM_INTERNAL(action_fn) \
+    { .is_handled = true, .p_target = NULL, .action = (action_fn) }
+
+// Forward-declarations.
+struct Evf_hsm_active_object;
+
+/* Used for transition, entry and exit actions. p_event is the event that caused the action, it is
+ * NULL for the entry actions run by evf_hsm_init.
+ */
+typedef void (*Evf_hsm_action)(struct Evf_hsm_active_object * p_self,
+                               struct Evf_event const * p_event);
+
+struct Evf_hsm_transition
+{
+    bool is_handled;
+    struct Evf_hsm_state const * p_target;
+    Evf_hsm_action action;
+};
+
+struct Evf_hsm_state
+{
+    char const * p_name;
+
+    // NULL for top-level states.
+    struct Evf_hsm_state const * p_parent;
+
+    /* When a transition targets a composite state, the initial child (and its initial child etc.)
+     * is entered too. NULL for leaf states.
+     */
+    struct Evf_hsm_state const * p_initial_child;
+
+    // Both may be NULL.
+    Evf_hsm_action on_entry;
+    Evf_hsm_action on_exit;
+
+    // Entering a final state shuts the active object down.
+    bool is_final;
+
+    // Use EVF_HSM_ON to designate the entries. Event types without an entry are not handled.
+    struct Evf_hsm_transition transitions[EVF_HSM_TABLE_LENGTH];
+};
+
+/* The 'base class' for HSM active objects, embed it as the first member the same way that 
+ * struct Evf_active_object is embedded in plain active objects. base.handle_event must be 
+ * evf_hsm_dispatch and base.accepts_event must be evf_hsm_accepts_event.
+ */
+struct Evf_hsm_active_object
+{
+    struct Evf_active_object base;
+
+    struct Evf_hsm_state const * const p_initial_state;
+
+    // For EVF-internal use only.
+    struct Evf_hsm_state const * p_current_state;
+};
+
+/**************************************************************************************************
+ * Enters the initial state (running its entry actions). Must be done after registering the active
+ * object and before evf_task is called.
+ *************************************************************************************************/
+void evf_hsm_init(struct Evf_hsm_active_object * p_hsm);
+
+/**************************************************************************************************
+ * The event handler for HSM active objects (see Evf_event_handler). Must only be given events that
+ * evf_hsm_accepts_event accepts.
+ *************************************************************************************************/
+enum Evf_active_object_status evf_hsm_dispatch(struct Evf_active_object * p_self,
+                                               struct Evf_event const * p_event);
+
+/**************************************************************************************************
+ * The event filter for HSM active objects (see Evf_event_filter), which accepts the events whose
+ * types the current state (or any of its parents) handles.
+ *************************************************************************************************/
+bool evf_hsm_accepts_event(struct Evf_active_object const * p_self, struct Evf_event const * p_event);
+
+/**************************************************************************************************
+ * Checks if the HSM's current state (or any of its parents) handles the event type.
+ *************************************************************************************************/
+bool evf_hsm_check_if_event_type_is_handled(struct Evf_hsm_active_object const * p_hsm, 
+                                            int32_t event_type);
+
+#endif // EVF_HSM_H
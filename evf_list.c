@@ -1,7 +1,14 @@
 
 #include "evf_list.h"
+#include "port/evf_port.h"
 #include <stddef.h>
 
+#if (EVF_ASSERTIONS_ENABLED == 1)
+#define EVF_ASSERT(condition)   evf_assert(condition)
+#else
+#define EVF_ASSERT(condition)  
+#endif
+
 /* Note: p_prev and p_next can be NULL e.g. if p_item is to be the new head or new tail of the
  * list. 
  */
@@ -91,7 +98,10 @@ void evf_list_remove_item(struct Evf_list * p_list, struct Evf_list_item * p_ite
     // Update the links for the prev and next elements of the item to be removed.
     struct Evf_list_item * p_prev = p_item->p_prev;
     struct Evf_list_item * p_next = p_item->p_next;
-    evf_list_item_set_links(p_prev->p_prev, p_prev, p_next);
-    evf_list_item_set_links(p_prev, p_next, p_next->p_next);
+    if (p_prev != NULL) { p_prev->p_next = p_next; }
+    else { p_list->p_head = p_next; }
+    if (p_next != NULL) { p_next->p_prev = p_prev; }
+    else { p_list->p_tail = p_prev; }
+    evf_list_item_init(p_item);
     p_list->length--;
 }
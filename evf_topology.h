@@ -0,0 +1,101 @@
+/**************************************************************************************************
+ * Generates the static topology (the active object registry and the subscription table) at
+ * compile time, for use with EVF_STATIC_TOPOLOGY_ENABLED. The topology is declared once, with two
+ * X-macros, in exactly one .c file which then includes this header e.g.
+ *
+ * extern struct Evf_active_object button_ao;
+ * extern struct Evf_active_object logger_ao;
+ * extern struct Adc_reader_active_object channel_1_reader_ao;
+ *
+ * // Every active object, in the order that they will be indexed.
+ * #define EVF_TOPOLOGY_ACTIVE_OBJECTS(X) \
+ *     X(&button_ao) \
+ *     X(&logger_ao) \
+ *     X(&channel_1_reader_ao.base)
+ *
+ * // Each user-defined event type that is published, followed by its NULL-terminated subscribers.
+ * #define EVF_TOPOLOGY_SUBSCRIPTIONS(X) \
+ *     X(EVENT_TYPE_BUTTON_PRESSED, &logger_ao, &channel_1_reader_ao.base, NULL) \
+ *     X(EVENT_TYPE_ADC_ERROR, &logger_ao, NULL) \
+ *     X(EVENT_TYPE_ADC_READY, NULL)
+ *
+ * #include "evf_topology.h"
+ *
+ * The following are checked at compile time...
+ * - The number of active objects does not exceed EVF_MAX_NUM_ACTIVE_OBJECTS.
+ * - Each event type is in the user-defined range.
+ * - Each event type is only listed once.
+ * - The number of subscribers to an event type does not exceed EVF_MAX_NUM_ACTIVE_OBJECTS.
+ *
+ * Note: event types must be plain identifiers (e.g. enum constants), since they are used to name
+ * the generated subscriber arrays.
+ * Note: the subscriber lists are terminated by NULL, the same way that event_type_subscriptions 
+ * are terminated by EVF_EVENT_TYPE_NULL, so that an event type can be listed without subscribers.
+ * A missing terminator is caught by evf_init when assertions are enabled.
+ * Note: the active objects must be defined with static storage duration and not be registered with
+ * evf_register_active_object (which is not available in this mode).
+ *************************************************************************************************/
+
+#ifndef EVF_TOPOLOGY_H
+#define EVF_TOPOLOGY_H
+
+#include "evf.h"
+#include <stddef.h>
+
+#if (EVF_STATIC_TOPOLOGY_ENABLED != 1)
+#error "evf_topology.h requires EVF_STATIC_TOPOLOGY_ENABLED to be 1"
+#endif
+
+#ifndef EVF_TOPOLOGY_ACTIVE_OBJECTS
+#error "EVF_TOPOLOGY_ACTIVE_OBJECTS must be defined before including evf_topology.h"
+#endif
+
+#ifndef EVF_TOPOLOGY_SUBSCRIPTIONS
+#error "EVF_TOPOLOGY_SUBSCRIPTIONS must be defined before including evf_topology.h"
+#endif
+
+#define EVF_TOPOLOGY_ARRAY_LENGTH(arr)    (sizeof(arr)/sizeof(arr[0]))
+
+#define EVF_TOPOLOGY_REGISTRY_ENTRY(p_ao)    p_ao,
+
+struct Evf_active_object * const evf_static_registry[] = {
+    EVF_TOPOLOGY_ACTIVE_OBJECTS(EVF_TOPOLOGY_REGISTRY_ENTRY)
+};
+
+uint32_t const evf_static_registry_length = EVF_TOPOLOGY_ARRAY_LENGTH(evf_static_registry);
+
+_Static_assert(EVF_TOPOLOGY_ARRAY_LENGTH(evf_static_registry) <= EVF_MAX_NUM_ACTIVE_OBJECTS,
+               "Too many active objects, increase EVF_MAX_NUM_ACTIVE_OBJECTS");
+
+/* One const, NULL-terminated array of subscribers per event type. The enum makes listing an event
+ * type twice a compile error (redeclared enumerator).
+ */
+#define EVF_TOPOLOGY_SUBSCRIBERS(event_type, ...)                                                 \
+    _Static_assert(((event_type) >= EVF_USER_EVENT_TYPES_START)                                   \
+                    && ((event_type) < EVF_MAX_NUM_USER_DEFINED_EVENT_TYPES),                     \
+                   "Event type " #event_type " is not in the user-defined range");                \
+    enum { evf_topology_event_type_listed_once_##event_type = (event_type) };                    \
+    static struct Evf_active_object * const evf_topology_subscribers_##event_type[] = {          \
+        __VA_ARGS__                                                                               \
+    };                                                                                            \
+    _Static_assert(EVF_TOPOLOGY_ARRAY_LENGTH(evf_topology_subscribers_##event_type) >= 1,         \
+                   "The subscribers to event type " #event_type " must be NULL-terminated");      \
+    _Static_assert(EVF_TOPOLOGY_ARRAY_LENGTH(evf_topology_subscribers_##event_type)               \
+                    <= (EVF_MAX_NUM_ACTIVE_OBJECTS + 1),                                          \
+                   "Too many subscribers to event type " #event_type);
+
+EVF_TOPOLOGY_SUBSCRIPTIONS(EVF_TOPOLOGY_SUBSCRIBERS)
+
+#define EVF_TOPOLOGY_SUBSCRIPTION_TABLE_ENTRY(event_type, ...)                                    \
+    [event_type] = {                                                                              \
+        .p_subscribers = evf_topology_subscribers_##event_type,                                   \
+        .num_subscribers = EVF_TOPOLOGY_ARRAY_LENGTH(evf_topology_subscribers_##event_type) - 1,  \
+    },
+
+// Event types that aren't listed have no subscribers.
+struct Evf_static_subscription_table_item const
+    evf_static_subscription_table[EVF_MAX_NUM_USER_DEFINED_EVENT_TYPES] = {
+    EVF_TOPOLOGY_SUBSCRIPTIONS(EVF_TOPOLOGY_SUBSCRIPTION_TABLE_ENTRY)
+};
+
+#endif // EVF_TOPOLOGY_H
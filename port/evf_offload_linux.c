@@ -0,0 +1,302 @@
+
+#include "evf_offload_linux.h"
+#include "evf_port.h"
+#include <pthread.h>
+#include <stddef.h>
+#include <time.h>
+
+// How often the completions that couldn't be posted (because their owners' queues were full) are retried.
+#define COMPLETION_RETRY_PERIOD_NS    1000000
+
+enum Job_state
+{
+    JOB_STATE_FREE,
+    JOB_STATE_QUEUED,
+    JOB_STATE_RUNNING,
+    JOB_STATE_COMPLETED, // Finished, but the completion event has not been posted yet.
+};
+
+/* A free job can only be reused once its completion event is no longer in use i.e. once the owner
+ * has handled it.
+ */
+struct Offload_job
+{
+    struct Evf_active_object * p_owner;
+    enum Job_state state;
+
+    // Links the job into either the job queue or the completed list.
+    struct Offload_job * p_next;
+
+    struct Evf_event_offload_done done_event;
+};
+
+// A FIFO of jobs, linked through p_next.
+struct Job_list
+{
+    struct Offload_job * p_head;
+    struct Offload_job * p_tail;
+};
+
+/**************************************************************************************************
+ * Static Variables
+ *************************************************************************************************/
+
+// Everything below is protected by the pool mutex.
+static pthread_mutex_t pool_mutex = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t job_queued_cond = PTHREAD_COND_INITIALIZER;
+
+static struct Offload_job jobs[EVF_OFFLOAD_MAX_NUM_JOBS];
+static struct Job_list job_queue;
+static struct Job_list completed_jobs;
+
+// Only one worker at a time posts the completed jobs, which lets completions from all workers batch.
+static bool is_flushing_completions;
+
+static bool is_pool_running;
+static pthread_t worker_threads[EVF_OFFLOAD_MAX_NUM_WORKERS];
+static uint32_t num_worker_threads;
+
+/**************************************************************************************************
+ * Static Functions
+ *************************************************************************************************/
+
+static void job_list_push(struct Job_list * p_list, struct Offload_job * p_job)
+{
+    p_job->p_next = NULL;
+    if (p_list->p_tail == NULL)
+    {
+        p_list->p_head = p_job;
+    }
+    else
+    {
+        p_list->p_tail->p_next = p_job;
+    }
+    p_list->p_tail = p_job;
+}
+
+static struct Offload_job * job_list_pop(struct Job_list * p_list)
+{
+    struct Offload_job * p_job = p_list->p_head;
+    if (p_job != NULL)
+    {
+        p_list->p_head = p_job->p_next;
+        if (p_list->p_head == NULL) { p_list->p_tail = NULL; }
+    }
+
+    return p_job;
+}
+
+// Must be called with the pool mutex held.
+static struct Offload_job * find_free_job()
+{
+    for (uint32_t i = 0; i < EVF_OFFLOAD_MAX_NUM_JOBS; i++)
+    {
+        if ((jobs[i].state == JOB_STATE_FREE) && !evf_event_check_is_in_use(&jobs[i].done_event))
+        {
+            return &jobs[i];
+        }
+    }
+
+    return NULL;
+}
+
+/* Posts the completed jobs until there are none left, or until one can't be posted because its
+ * owner's queue is full. Completions that arrive from other workers in the meantime are posted in
+ * the next batch. The ones that couldn't be posted are kept, in order, at the front of the
+ * completed list to be retried later. Must be called with the pool mutex held, which is released
+ * while posting.
+ */
+static void flush_completed_jobs()
+{
+    bool were_all_posted = true;
+    while (were_all_posted && (completed_jobs.p_head != NULL))
+    {
+        struct Job_list batch = completed_jobs;
+        completed_jobs = (struct Job_list){ NULL, NULL };
+        pthread_mutex_unlock(&pool_mutex);
+
+        struct Job_list posted = { NULL, NULL };
+        struct Job_list unposted = { NULL, NULL };
+        evf_critical_section_enter();
+        struct Offload_job * p_job;
+        while ((p_job = job_list_pop(&batch)) != NULL)
+        {
+            bool okay = evf_post_static(p_job->p_owner, &p_job->done_event.base);
+            job_list_push(okay ? &posted : &unposted, p_job);
+        }
+        evf_critical_section_exit();
+
+        pthread_mutex_lock(&pool_mutex);
+        while ((p_job = job_list_pop(&posted)) != NULL)
+        {
+            p_job->state = JOB_STATE_FREE;
+        }
+
+        if (unposted.p_head != NULL)
+        {
+            // The unposted jobs go before any that completed while posting, to keep them in order.
+            if (completed_jobs.p_head != NULL)
+            {
+                unposted.p_tail->p_next = completed_jobs.p_head;
+                unposted.p_tail = completed_jobs.p_tail;
+            }
+            completed_jobs = unposted;
+            were_all_posted = false;
+        }
+    }
+}
+
+// Must be called with the pool mutex held, which is released while the job runs.
+static void run_job(struct Offload_job * p_job)
+{
+    p_job->state = JOB_STATE_RUNNING;
+    pthread_mutex_unlock(&pool_mutex);
+
+    p_job->done_event.job(p_job->done_event.p_context);
+
+    pthread_mutex_lock(&pool_mutex);
+    p_job->state = JOB_STATE_COMPLETED;
+    job_list_push(&completed_jobs, p_job);
+}
+
+// Waits until a job is queued, the pool is stopped or the completion retry period has passed.
+static void wait_for_completion_retry()
+{
+    struct timespec deadline;
+    clock_gettime(CLOCK_REALTIME, &deadline);
+    deadline.tv_nsec += COMPLETION_RETRY_PERIOD_NS;
+    if (deadline.tv_nsec >= 1000000000)
+    {
+        deadline.tv_sec++;
+        deadline.tv_nsec -= 1000000000;
+    }
+    pthread_cond_timedwait(&job_queued_cond, &pool_mutex, &deadline);
+}
+
+static void * worker_thread_main(void * p_arg)
+{
+    (void)p_arg;
+
+    pthread_mutex_lock(&pool_mutex);
+    while (is_pool_running)
+    {
+        struct Offload_job * p_job = job_list_pop(&job_queue);
+        if (p_job != NULL)
+        {
+            run_job(p_job);
+        }
+        else if (completed_jobs.p_head != NULL)
+        {
+            /* Completions that couldn't be posted are retried periodically (while still taking
+             * jobs), giving their owners a chance to drain their queues.
+             */
+            wait_for_completion_retry();
+        }
+        else
+        {
+            pthread_cond_wait(&job_queued_cond, &pool_mutex);
+            continue;
+        }
+
+        if (is_pool_running && !is_flushing_completions)
+        {
+            is_flushing_completions = true;
+            flush_completed_jobs();
+            is_flushing_completions = false;
+        }
+    }
+    pthread_mutex_unlock(&pool_mutex);
+
+    return NULL;
+}
+
+/**************************************************************************************************
+ * API function implementations
+ *************************************************************************************************/
+
+bool evf_offload_start(uint32_t num_workers)
+{
+    evf_assert((num_workers > 0) && (num_workers <= EVF_OFFLOAD_MAX_NUM_WORKERS));
+
+    pthread_mutex_lock(&pool_mutex);
+    if (is_pool_running || (num_worker_threads != 0))
+    {
+        pthread_mutex_unlock(&pool_mutex);
+        return false;
+    }
+
+    for (uint32_t i = 0; i < EVF_OFFLOAD_MAX_NUM_JOBS; i++)
+    {
+        if (!evf_event_check_is_in_use(&jobs[i].done_event))
+        {
+            evf_event_init_static(&jobs[i].done_event, EVF_EVENT_TYPE_OFFLOAD_DONE);
+        }
+    }
+
+    is_pool_running = true;
+    while (num_worker_threads < num_workers)
+    {
+        if (pthread_create(&worker_threads[num_worker_threads], NULL, &worker_thread_main, NULL) != 0)
+        {
+            break;
+        }
+        num_worker_threads++;
+    }
+    pthread_mutex_unlock(&pool_mutex);
+
+    if (num_worker_threads < num_workers)
+    {
+        evf_offload_stop();
+        return false;
+    }
+
+    return true;
+}
+
+void evf_offload_stop()
+{
+    pthread_mutex_lock(&pool_mutex);
+    is_pool_running = false;
+    pthread_cond_broadcast(&job_queued_cond);
+    pthread_mutex_unlock(&pool_mutex);
+
+    for (uint32_t i = 0; i < num_worker_threads; i++)
+    {
+        pthread_join(worker_threads[i], NULL);
+    }
+
+    pthread_mutex_lock(&pool_mutex);
+    num_worker_threads = 0;
+
+    // Drop the jobs that were never started.
+    struct Offload_job * p_job;
+    while ((p_job = job_list_pop(&job_queue)) != NULL)
+    {
+        p_job->state = JOB_STATE_FREE;
+    }
+
+    // A last attempt at posting the completions, any that still can't be posted wait for the next start.
+    flush_completed_jobs();
+    pthread_mutex_unlock(&pool_mutex);
+}
+
+bool evf_offload(struct Evf_active_object * p_ao, Evf_offload_job job, void * p_context)
+{
+    evf_assert(p_ao != NULL);
+    evf_assert(job != NULL);
+
+    pthread_mutex_lock(&pool_mutex);
+    struct Offload_job * p_job = is_pool_running ? find_free_job() : NULL;
+    if (p_job != NULL)
+    {
+        p_job->p_owner = p_ao;
+        p_job->state = JOB_STATE_QUEUED;
+        p_job->done_event.job = job;
+        p_job->done_event.p_context = p_context;
+        job_list_push(&job_queue, p_job);
+        pthread_cond_signal(&job_queued_cond);
+    }
+    pthread_mutex_unlock(&pool_mutex);
+
+    return (p_job != NULL);
+}
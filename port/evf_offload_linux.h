@@ -0,0 +1,84 @@
+/**************************************************************************************************
+ * Runs blocking work (e.g. file I/O, compression, checksums) on a pool of worker threads, so that
+ * it doesn't stall evf_task. When a job has finished, an Evf_event_offload_done event is posted
+ * back to the active object that offloaded it e.g.
+ *
+ * // In the handler of the active object.
+ * if (!evf_offload(p_self, &compress_log_file, p_compress_job))
+ * {
+ *     // All EVF_OFFLOAD_MAX_NUM_JOBS jobs are in flight, try again later.
+ * }
+ * ...
+ * case EVF_EVENT_TYPE_OFFLOAD_DONE:
+ *     struct Evf_event_offload_done const * p_done = (void const *)p_event;
+ *     // p_done->p_context is p_compress_job.
+ *
+ * The number of jobs that can be queued or running at once is bounded, and the completion events
+ * are preallocated, so offloading never allocates. Completions from all of the workers are posted
+ * in batches, so a worker only takes the EVF critical section once per batch rather than once per
+ * job.
+ *
+ * Note: jobs run on the worker threads, so they must not touch the active object's state. Anything
+ * shared between a job and its active object should only be accessed by the active object once the
+ * completion event has been received.
+ *************************************************************************************************/
+
+#ifndef EVF_OFFLOAD_LINUX_H
+#define EVF_OFFLOAD_LINUX_H
+
+#include "../evf.h"
+#include "evf_port_linux.h"
+#include <stdint.h>
+#include <stdbool.h>
+
+// The maximum number of offloaded jobs that can be queued, running or awaiting completion at once.
+#ifndef EVF_OFFLOAD_MAX_NUM_JOBS
+#define EVF_OFFLOAD_MAX_NUM_JOBS    32
+#endif
+
+#ifndef EVF_OFFLOAD_MAX_NUM_WORKERS
+#define EVF_OFFLOAD_MAX_NUM_WORKERS    8
+#endif
+
+// Runs on a worker thread. p_context is whatever was passed to evf_offload.
+typedef void (*Evf_offload_job)(void * p_context);
+
+/* Posted to the active object that offloaded a job once it has finished. These events are
+ * preallocated and their memory is reused for later jobs once they have been handled.
+ */
+struct Evf_event_offload_done
+{
+    struct Evf_event base; // The type is EVF_EVENT_TYPE_OFFLOAD_DONE.
+    Evf_offload_job job;
+    void * p_context;
+};
+
+/**************************************************************************************************
+ * Starts num_workers (at most EVF_OFFLOAD_MAX_NUM_WORKERS) worker threads. Must be called after
+ * evf_init. Returns false if the pool is already started or the threads could not be created.
+ *************************************************************************************************/
+bool evf_offload_start(uint32_t num_workers);
+
+/**************************************************************************************************
+ * Stops the worker threads, waiting for any running jobs to finish. Jobs that haven't been started
+ * are dropped, so they never complete. May be called from the thread that calls evf_task (but not
+ * from within a critical section).
+ *
+ * Completions that are pending because their owners' queues are full are posted one last time, and
+ * any that still can't be posted are kept, to be retried once the pool is started again. Their
+ * jobs stay in flight (counting towards EVF_OFFLOAD_MAX_NUM_JOBS) until then.
+ *************************************************************************************************/
+void evf_offload_stop();
+
+/**************************************************************************************************
+ * Queues a job to be run on a worker thread. Once job(p_context) has returned, an
+ * Evf_event_offload_done event is posted to p_ao. Returns false (and the job is not run) if the
+ * pool is not started or EVF_OFFLOAD_MAX_NUM_JOBS jobs are already in flight. May be called from
+ * any thread.
+ *
+ * Note: if p_ao's queue is full, the completion is retried periodically until it has been posted,
+ * so no completions are lost (see evf_offload_stop for what happens to them when the pool stops).
+ *************************************************************************************************/
+bool evf_offload(struct Evf_active_object * p_ao, Evf_offload_job job, void * p_context);
+
+#endif // EVF_OFFLOAD_LINUX_H
@@ -52,6 +52,20 @@ void evf_critical_section_exit();
  *************************************************************************************************/
 uint64_t evf_get_timestamp_ms(); 
 
+/**************************************************************************************************
+ * The same as evf_get_timestamp_ms but in microseconds, for timing run-to-completion steps. Only
+ * required if EVF_RTC_BUDGETS_ENABLED is 1.
+ *************************************************************************************************/
+uint64_t evf_get_timestamp_us(); 
+
+/**************************************************************************************************
+ * Called from evf_publish_from_isr (i.e. from an ISR or signal handler) after an event has been 
+ * deferred, to wake the context that calls evf_task if it is waiting for work. Must therefore be
+ * async-signal-safe. May be empty if the ISR itself wakes that context anyway (e.g. a WFI-based
+ * idle loop). Only required if EVF_ISR_PUBLISH_ENABLED is 1.
+ *************************************************************************************************/
+void evf_notify_from_isr();
+
 /**************************************************************************************************
  * Schedules a callback at a particular timestamp. This must be the same counter that is used for
  * evf_get_timestamp_ms. Only one callback can be scheduled at a time. Scheduling a new callback
@@ -1,7 +1,286 @@
 
+#define _GNU_SOURCE // For PTHREAD_RECURSIVE_MUTEX_INITIALIZER_NP.
+
 #include "evf_port.h"
+#include "evf_port_linux.h"
+#include "../evf.h"
 #include <assert.h>
 #include <malloc.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdio.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <time.h>
+#include <unistd.h>
+
+// The maximum number of fd readiness notifications taken from epoll per wait.
+#define MAX_NUM_EPOLL_EVENTS_PER_WAIT    16
+
+/* A watched fd. The readiness event is embedded, so delivering readiness never allocates. An unused
+ * watch has an fd of -1, but can only be reused once its readiness event is no longer in use.
+ */
+struct Fd_watch
+{
+    struct Evf_active_object * p_owner;
+    int fd;
+
+    struct Evf_event_fd_ready ready_event;
+
+    // Readiness that could not be posted yet because the owner's queue was full.
+    uint32_t unposted_events;
+};
+
+/* A recursive mutex since critical sections must be nestable. The depth is protected by the mutex
+ * itself and is used to only wake the idle waiter when the outermost critical section is exited.
+ */
+static pthread_mutex_t critical_section_mutex = PTHREAD_RECURSIVE_MUTEX_INITIALIZER_NP;
+static uint32_t critical_section_depth;
+
+/* The idle waiter sleeps in epoll_wait, so that it wakes for whichever comes first: the next timer
+ * deadline (the timeout), readiness of a watched fd, or a write to the wake eventfd. Other threads
+ * write to the eventfd when they queue work or move the next timer deadline, and since writing to
+ * an eventfd is async-signal-safe so do signal handlers (see evf_notify_from_isr). Any extra wakes
+ * only cause the waiter to re-check for work.
+ */
+static pthread_once_t idle_wait_init_once = PTHREAD_ONCE_INIT;
+static int idle_wait_epoll_fd = -1;
+static int idle_wait_wake_fd = -1;
+static atomic_bool is_idle_wait_initialised;
+
+// Protected by the critical section, and reset at the start of every idle period.
+static bool is_idle_waiting;
+static bool is_idle_wake_pending; // The eventfd has been written to, so it isn't written again.
+static bool has_scheduled_callback_changed;
+
+// Protected by the critical section.
+static struct Fd_watch fd_watches[EVF_LINUX_MAX_NUM_FD_WATCHES];
+static bool is_any_fd_readiness_unposted;
+
+// Protected by the critical section.
+static Evf_timer_callback scheduled_callback;
+static uint64_t scheduled_callback_timestamp_ms;
+
+#if (EVF_RTC_BUDGETS_ENABLED == 1)
+/* The stop condition variable waits on CLOCK_MONOTONIC (like the EVF's timestamps), so that the 
+ * check period is not affected by the wall clock being set. It is initialised once, since 
+ * evf_linux_watchdog_stop may signal it whether or not the watchdog was ever started.
+ */
+static pthread_once_t watchdog_init_once = PTHREAD_ONCE_INIT;
+static pthread_t watchdog_thread;
+static pthread_mutex_t watchdog_mutex = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t watchdog_stop_cond;
+
+// Protected by watchdog_mutex.
+static bool is_watchdog_running;
+static uint32_t watchdog_budget_multiplier;
+static uint32_t watchdog_check_period_ms;
+static Evf_linux_watchdog_hook watchdog_hook;
+#endif
+
+static void idle_wait_init()
+{
+    for (uint32_t i = 0; i < EVF_LINUX_MAX_NUM_FD_WATCHES; i++)
+    {
+        fd_watches[i].fd = -1;
+        evf_event_init_static(&fd_watches[i].ready_event, EVF_EVENT_TYPE_FD_READY);
+    }
+
+    idle_wait_epoll_fd = epoll_create1(EPOLL_CLOEXEC);
+    idle_wait_wake_fd = eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK);
+    assert((idle_wait_epoll_fd != -1) && (idle_wait_wake_fd != -1));
+
+    // The wake eventfd is told apart from the fd watches by its NULL data pointer.
+    struct epoll_event wake_event = { .events = EPOLLIN, .data.ptr = NULL };
+    epoll_ctl(idle_wait_epoll_fd, EPOLL_CTL_ADD, idle_wait_wake_fd, &wake_event);
+
+    atomic_store(&is_idle_wait_initialised, true);
+}
+
+static void wake_idle_waiter()
+{
+    uint64_t increment = 1;
+    ssize_t num_written = write(idle_wait_wake_fd, &increment, sizeof(increment));
+    (void)num_written; // Can only fail if the counter is saturated, in which case it's awake anyway.
+}
+
+// Must be called within the critical section.
+static void post_fd_readiness(struct Fd_watch * p_watch, uint32_t events)
+{
+    struct Evf_event_fd_ready * p_event = &p_watch->ready_event;
+
+    /* Watches are edge-triggered, so readiness is reported once per edge. If the previous readiness
+     * event has not been handled yet, the new readiness is merged into it rather than posting 
+     * another event, so an active object gets at most one readiness event per fd in its queue.
+     */
+    if (evf_event_check_is_in_use(p_event))
+    {
+        p_event->events |= events;
+        return;
+    }
+
+    p_event->fd = p_watch->fd;
+    p_event->events = events | p_watch->unposted_events;
+    if (evf_post_static(p_watch->p_owner, &p_event->base))
+    {
+        p_watch->unposted_events = 0;
+    }
+    else
+    {
+        p_watch->unposted_events = p_event->events;
+        is_any_fd_readiness_unposted = true;
+    }
+}
+
+// Must be called within the critical section.
+static void retry_unposted_fd_readiness()
+{
+    is_any_fd_readiness_unposted = false;
+    for (uint32_t i = 0; i < EVF_LINUX_MAX_NUM_FD_WATCHES; i++)
+    {
+        struct Fd_watch * p_watch = &fd_watches[i];
+        if ((p_watch->fd != -1) && (p_watch->unposted_events != 0))
+        {
+            post_fd_readiness(p_watch, 0);
+        }
+    }
+}
+
+// Must be called within the critical section.
+static struct Fd_watch * find_fd_watch(int fd)
+{
+    for (uint32_t i = 0; i < EVF_LINUX_MAX_NUM_FD_WATCHES; i++)
+    {
+        if (fd_watches[i].fd == fd) { return &fd_watches[i]; }
+    }
+
+    return NULL;
+}
+
+// Returns the epoll_wait timeout, rounded up so that the waiter does not wake before the deadline.
+static int get_idle_wait_timeout_ms(enum Evf_next_wakeup next_wakeup, uint64_t wakeup_timestamp_ms)
+{
+    if (next_wakeup == EVF_NEXT_WAKEUP_NONE)
+    {
+        return -1;
+    }
+
+    uint64_t now_us = evf_get_timestamp_us();
+    uint64_t wakeup_timestamp_us = wakeup_timestamp_ms * 1000;
+    if (wakeup_timestamp_us <= now_us)
+    {
+        return 0;
+    }
+
+    uint64_t timeout_ms = ((wakeup_timestamp_us - now_us) + 999) / 1000;
+    return (timeout_ms > INT32_MAX) ? INT32_MAX : (int)timeout_ms;
+}
+
+// Must be called within the (outermost) critical section.
+static void idle_wait_until(enum Evf_next_wakeup next_wakeup, uint64_t wakeup_timestamp_ms)
+{
+    // The mutex is released while waiting so other threads must not see this thread's depth.
+    uint32_t saved_depth = critical_section_depth;
+    critical_section_depth = 0;
+    is_idle_waiting = true;
+    is_idle_wake_pending = false;
+    has_scheduled_callback_changed = false;
+    int timeout_ms = get_idle_wait_timeout_ms(next_wakeup, wakeup_timestamp_ms);
+
+    pthread_mutex_unlock(&critical_section_mutex);
+
+    // Interruptions (EINTR) and timeouts are fine, the caller re-checks for work either way.
+    struct epoll_event ready_events[MAX_NUM_EPOLL_EVENTS_PER_WAIT];
+    int num_ready = epoll_wait(idle_wait_epoll_fd, ready_events, MAX_NUM_EPOLL_EVENTS_PER_WAIT, timeout_ms);
+
+    pthread_mutex_lock(&critical_section_mutex);
+    is_idle_waiting = false;
+    critical_section_depth = saved_depth;
+
+    for (int i = 0; i < num_ready; i++)
+    {
+        struct Fd_watch * p_watch = ready_events[i].data.ptr;
+        if (p_watch == NULL)
+        {
+            // Any wakes that built up while waiting are covered by the caller's re-check.
+            uint64_t count;
+            ssize_t num_read = read(idle_wait_wake_fd, &count, sizeof(count));
+            (void)num_read;
+        }
+        else if (p_watch->fd != -1)
+        {
+            post_fd_readiness(p_watch, ready_events[i].events);
+        }
+    }
+}
+
+#if (EVF_RTC_BUDGETS_ENABLED == 1)
+static void watchdog_init()
+{
+    pthread_condattr_t cond_attributes;
+    pthread_condattr_init(&cond_attributes);
+    pthread_condattr_setclock(&cond_attributes, CLOCK_MONOTONIC);
+    pthread_cond_init(&watchdog_stop_cond, &cond_attributes);
+    pthread_condattr_destroy(&cond_attributes);
+}
+
+static void report_stuck_rtc_step(struct Evf_rtc_step_info const * p_step, uint64_t duration_us)
+{
+    if (watchdog_hook != NULL)
+    {
+        watchdog_hook(p_step, duration_us);
+        return;
+    }
+
+    fprintf(stderr,
+            "EVF watchdog: active object \"%s\" stuck handling event type %d for %llu us "
+            "(budget %u us)\n",
+            p_step->p_ao->name,
+            (int)p_step->event_type,
+            (unsigned long long)duration_us,
+            (unsigned)p_step->p_ao->rtc_budget_us);
+}
+
+static void * watchdog_thread_main(void * p_arg)
+{
+    (void)p_arg;
+    uint32_t last_reported_step_number = 0;
+    bool has_reported = false;
+
+    pthread_mutex_lock(&watchdog_mutex);
+    while (is_watchdog_running)
+    {
+        struct timespec deadline;
+        clock_gettime(CLOCK_MONOTONIC, &deadline);
+        deadline.tv_sec += watchdog_check_period_ms / 1000;
+        deadline.tv_nsec += (long)(watchdog_check_period_ms % 1000) * 1000000;
+        if (deadline.tv_nsec >= 1000000000)
+        {
+            deadline.tv_sec++;
+            deadline.tv_nsec -= 1000000000;
+        }
+        pthread_cond_timedwait(&watchdog_stop_cond, &watchdog_mutex, &deadline);
+
+        struct Evf_rtc_step_info step;
+        if (!is_watchdog_running || !evf_get_current_rtc_step(&step) || (step.p_ao->rtc_budget_us == 0))
+        {
+            continue;
+        }
+
+        uint64_t duration_us = evf_get_timestamp_us() - step.start_timestamp_us;
+        uint64_t limit_us = (uint64_t)step.p_ao->rtc_budget_us * watchdog_budget_multiplier;
+        if ((duration_us > limit_us) && (!has_reported || (step.step_number != last_reported_step_number)))
+        {
+            report_stuck_rtc_step(&step, duration_us);
+            last_reported_step_number = step.step_number;
+            has_reported = true;
+        }
+    }
+    pthread_mutex_unlock(&watchdog_mutex);
+
+    return NULL;
+}
+#endif
 
 void * evf_malloc(size_t num_bytes)
 {
@@ -13,7 +292,195 @@ void evf_free(void * p_memory)
     free(p_memory);
 }
 
-static void evf_assert(bool condition)
+void evf_assert(bool condition)
 {
     assert(condition); 
-}
\ No newline at end of file
+}
+
+void evf_critical_section_enter()
+{
+    pthread_mutex_lock(&critical_section_mutex);
+    critical_section_depth++;
+}
+
+void evf_critical_section_exit()
+{
+    /* Let the idle waiter (if there is one) re-check once work has been queued or the next timer 
+     * deadline has moved. It is woken at most once per idle period, however many critical sections
+     * are exited before it runs again.
+     */
+    critical_section_depth--;
+    if ((critical_section_depth == 0) && is_idle_waiting && !is_idle_wake_pending
+        && (evf_check_if_work_to_do() || has_scheduled_callback_changed))
+    {
+        is_idle_wake_pending = true;
+        wake_idle_waiter();
+    }
+    pthread_mutex_unlock(&critical_section_mutex);
+}
+
+uint64_t evf_get_timestamp_ms()
+{
+    // CLOCK_MONOTONIC is unaffected by changes to the wall-clock time.
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return ((uint64_t)now.tv_sec * 1000) + ((uint64_t)now.tv_nsec / 1000000);
+}
+
+uint64_t evf_get_timestamp_us()
+{
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return ((uint64_t)now.tv_sec * 1000000) + ((uint64_t)now.tv_nsec / 1000);
+}
+
+void evf_notify_from_isr()
+{
+    // If the idle wait was never initialised then nothing is waiting, it'll see the work itself.
+    if (atomic_load(&is_idle_wait_initialised))
+    {
+        wake_idle_waiter();
+    }
+}
+
+void evf_schedule_callback(uint64_t timestamp_ms, Evf_timer_callback callback)
+{
+    evf_critical_section_enter();
+    scheduled_callback_timestamp_ms = timestamp_ms;
+    scheduled_callback = callback;
+    has_scheduled_callback_changed = true;
+    evf_critical_section_exit();
+}
+
+void evf_cancel_scheduled_callback()
+{
+    evf_critical_section_enter();
+    scheduled_callback = NULL;
+    evf_critical_section_exit();
+}
+
+void evf_linux_wait_for_work()
+{
+    pthread_once(&idle_wait_init_once, &idle_wait_init);
+
+    evf_critical_section_enter();
+    while (true)
+    {
+        if (is_any_fd_readiness_unposted)
+        {
+            retry_unposted_fd_readiness();
+        }
+
+        uint64_t wakeup_timestamp_ms = 0;
+        enum Evf_next_wakeup next_wakeup = evf_get_next_wakeup(&wakeup_timestamp_ms);
+        if (next_wakeup == EVF_NEXT_WAKEUP_NOW)
+        {
+            break;
+        }
+
+        if ((scheduled_callback != NULL) && (scheduled_callback_timestamp_ms <= evf_get_timestamp_ms()))
+        {
+            // The callback may schedule a new callback so it must be cleared before calling it.
+            Evf_timer_callback callback = scheduled_callback;
+            scheduled_callback = NULL;
+            callback();
+            continue;
+        }
+
+        idle_wait_until(next_wakeup, wakeup_timestamp_ms);
+    }
+    evf_critical_section_exit();
+}
+
+bool evf_linux_fd_watch(struct Evf_active_object * p_ao, int fd, uint32_t events)
+{
+    evf_assert(p_ao != NULL);
+    evf_assert(fd >= 0);
+
+    pthread_once(&idle_wait_init_once, &idle_wait_init);
+
+    evf_critical_section_enter();
+
+    // Find an unused watch whose readiness event has been handled.
+    struct Fd_watch * p_watch = NULL;
+    for (uint32_t i = 0; (i < EVF_LINUX_MAX_NUM_FD_WATCHES) && (p_watch == NULL); i++)
+    {
+        if ((fd_watches[i].fd == -1) && !evf_event_check_is_in_use(&fd_watches[i].ready_event))
+        {
+            p_watch = &fd_watches[i];
+        }
+    }
+
+    bool okay = false;
+    if ((p_watch != NULL) && (find_fd_watch(fd) == NULL))
+    {
+        struct epoll_event epoll_event = { .events = events | EPOLLET, .data.ptr = p_watch };
+        if (epoll_ctl(idle_wait_epoll_fd, EPOLL_CTL_ADD, fd, &epoll_event) == 0)
+        {
+            p_watch->p_owner = p_ao;
+            p_watch->fd = fd;
+            p_watch->unposted_events = 0;
+            okay = true;
+        }
+    }
+
+    evf_critical_section_exit();
+
+    return okay;
+}
+
+void evf_linux_fd_unwatch(int fd)
+{
+    pthread_once(&idle_wait_init_once, &idle_wait_init);
+
+    evf_critical_section_enter();
+
+    struct Fd_watch * p_watch = (fd >= 0) ? find_fd_watch(fd) : NULL;
+    if (p_watch != NULL)
+    {
+        epoll_ctl(idle_wait_epoll_fd, EPOLL_CTL_DEL, fd, NULL);
+        p_watch->fd = -1;
+        p_watch->unposted_events = 0;
+    }
+
+    evf_critical_section_exit();
+}
+
+#if (EVF_RTC_BUDGETS_ENABLED == 1)
+bool evf_linux_watchdog_start(uint32_t budget_multiplier, uint32_t check_period_ms)
+{
+    evf_assert(!is_watchdog_running);
+    evf_assert((budget_multiplier > 0) && (check_period_ms > 0));
+    pthread_once(&watchdog_init_once, &watchdog_init);
+
+    watchdog_budget_multiplier = budget_multiplier;
+    watchdog_check_period_ms = check_period_ms;
+    is_watchdog_running = true;
+    if (pthread_create(&watchdog_thread, NULL, &watchdog_thread_main, NULL) != 0)
+    {
+        is_watchdog_running = false;
+        return false;
+    }
+
+    return true;
+}
+
+void evf_linux_watchdog_stop()
+{
+    pthread_once(&watchdog_init_once, &watchdog_init);
+    pthread_mutex_lock(&watchdog_mutex);
+    bool was_running = is_watchdog_running;
+    is_watchdog_running = false;
+    pthread_cond_signal(&watchdog_stop_cond);
+    pthread_mutex_unlock(&watchdog_mutex);
+
+    if (was_running) { pthread_join(watchdog_thread, NULL); }
+}
+
+void evf_linux_register_watchdog_hook(Evf_linux_watchdog_hook hook)
+{
+    pthread_mutex_lock(&watchdog_mutex);
+    watchdog_hook = hook;
+    pthread_mutex_unlock(&watchdog_mutex);
+}
+#endif
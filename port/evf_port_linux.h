@@ -0,0 +1,90 @@
+/**************************************************************************************************
+ * Linux-specific additions to the port. These may be used by application code.
+ *************************************************************************************************/
+
+#ifndef EVF_PORT_LINUX_H
+#define EVF_PORT_LINUX_H
+
+#include "../evf.h"
+#include <stdint.h>
+#include <stdbool.h>
+
+/* The Linux port's event types, taken from the range that is reserved for ports. They are all
+ * allocated here so that they can't overlap.
+ */
+#define EVF_EVENT_TYPE_FD_READY         (EVF_PORT_EVENT_TYPES_START + 0)
+#define EVF_EVENT_TYPE_OFFLOAD_DONE     (EVF_PORT_EVENT_TYPES_START + 1) // See evf_offload_linux.h.
+
+#ifndef EVF_LINUX_MAX_NUM_FD_WATCHES
+#define EVF_LINUX_MAX_NUM_FD_WATCHES    16
+#endif
+
+/* Posted to the owner of a watched file descriptor (see evf_linux_fd_watch) when it becomes ready.
+ * These events are preallocated, so delivering readiness never allocates.
+ */
+struct Evf_event_fd_ready
+{
+    struct Evf_event base; // The type is EVF_EVENT_TYPE_FD_READY.
+    int fd;
+    uint32_t events; // The epoll events (e.g. EPOLLIN, EPOLLOUT, EPOLLHUP) that became ready.
+};
+
+/**************************************************************************************************
+ * Blocks the calling thread until there is work for evf_task to do. While waiting, the thread 
+ * sleeps (in epoll_wait) until exactly the next timer deadline (see evf_get_next_wakeup) and calls
+ * the timer handler callback itself, until a watched fd becomes ready (see evf_linux_fd_watch), or
+ * until an event is posted/published from another thread. Intended for the loop that calls 
+ * evf_task, so that one thread runs I/O, timers and dispatch together e.g.
+ * while (evf_task() == EVF_STATUS_RUNNING) { evf_linux_wait_for_work(); }
+ * Note: must not be called from within a critical section.
+ *************************************************************************************************/
+void evf_linux_wait_for_work();
+
+/**************************************************************************************************
+ * Watches a file descriptor (e.g. a socket) for the given epoll events (e.g. EPOLLIN | EPOLLOUT). 
+ * When it becomes ready, an Evf_event_fd_ready event is posted straight to p_ao's queue by 
+ * evf_linux_wait_for_work. Watches are edge-triggered: readiness is reported once per edge, so the
+ * active object must read/write until EAGAIN. Readiness that arrives while the previous event for
+ * the fd is still queued is merged into that event, and readiness that can't be posted because the
+ * queue is full is retried. Note: evf_linux_wait_for_work and evf_task must run on the same thread
+ * when fds are watched.
+ * 
+ * Returns false if the fd is already watched, all EVF_LINUX_MAX_NUM_FD_WATCHES watches are in use
+ * or epoll rejects the fd.
+ *************************************************************************************************/
+bool evf_linux_fd_watch(struct Evf_active_object * p_ao, int fd, uint32_t events);
+
+/**************************************************************************************************
+ * Stops watching a file descriptor. Must be done before the fd is closed. Has no effect if the fd
+ * is not watched. A readiness event that is already queued is still delivered.
+ *************************************************************************************************/
+void evf_linux_fd_unwatch(int fd);
+
+#if (EVF_RTC_BUDGETS_ENABLED == 1)
+// See evf_linux_register_watchdog_hook.
+typedef void (*Evf_linux_watchdog_hook)(struct Evf_rtc_step_info const * p_step, uint64_t duration_us);
+
+/**************************************************************************************************
+ * Starts a watchdog thread that checks the run-to-completion step in progress every 
+ * check_period_ms milliseconds. If an active object with an rtc_budget_us has been in the same 
+ * step for longer than budget_multiplier times its budget, the active object's name and the event 
+ * type are reported on stderr, or to the watchdog hook (once per step). Returns false if the 
+ * thread could not be started.
+ *************************************************************************************************/
+bool evf_linux_watchdog_start(uint32_t budget_multiplier, uint32_t check_period_ms);
+
+/**************************************************************************************************
+ * Stops the watchdog thread. Has no effect if it is not running.
+ *************************************************************************************************/
+void evf_linux_watchdog_stop();
+
+/**************************************************************************************************
+ * Registers a hook that stuck steps are reported to instead of stderr (see 
+ * evf_linux_watchdog_start). It is called from the watchdog thread, with the step's duration so 
+ * far, while the step is still in progress. It must not start or stop the watchdog. Use NULL to 
+ * de-register it.
+ *************************************************************************************************/
+void evf_linux_register_watchdog_hook(Evf_linux_watchdog_hook hook);
+#endif
+
+#endif // EVF_PORT_LINUX_H
@@ -0,0 +1,136 @@
+
+#include "evf_port.h"
+#include "evf_port_sim.h"
+#include "../evf.h"
+#include <assert.h>
+#include <malloc.h>
+
+static uint64_t virtual_timestamp_ms;
+
+static Evf_timer_callback scheduled_callback;
+static uint64_t scheduled_callback_timestamp_ms;
+
+static void handle_all_pending_events()
+{
+    while (evf_check_if_work_to_do())
+    {
+        evf_task();
+    }
+}
+
+/* Calls the scheduled callback if it is due at or before limit_timestamp_ms, with the virtual 
+ * clock set to the callback's timestamp. Returns false if there was no such callback.
+ */
+static bool call_scheduled_callback_if_due(uint64_t limit_timestamp_ms)
+{
+    if ((scheduled_callback == NULL) || (scheduled_callback_timestamp_ms > limit_timestamp_ms))
+    {
+        return false;
+    }
+
+    if (scheduled_callback_timestamp_ms > virtual_timestamp_ms)
+    {
+        virtual_timestamp_ms = scheduled_callback_timestamp_ms;
+    }
+
+    // The callback may schedule a new callback so it must be cleared before calling it.
+    Evf_timer_callback callback = scheduled_callback;
+    scheduled_callback = NULL;
+    callback();
+
+    return true;
+}
+
+void * evf_malloc(size_t num_bytes)
+{
+    return malloc(num_bytes);
+}
+
+void evf_free(void * p_memory)
+{
+    free(p_memory);
+}
+
+void evf_assert(bool condition)
+{
+    assert(condition); 
+}
+
+void evf_critical_section_enter()
+{
+    // Nothing to do, the simulation is single-threaded.
+}
+
+void evf_critical_section_exit()
+{
+    // Nothing to do, the simulation is single-threaded.
+}
+
+uint64_t evf_get_timestamp_ms()
+{
+    return virtual_timestamp_ms;
+}
+
+uint64_t evf_get_timestamp_us()
+{
+    return virtual_timestamp_ms * 1000;
+}
+
+void evf_notify_from_isr()
+{
+    // Nothing to do, evf_sim_advance/evf_sim_run_until_idle check for work themselves.
+}
+
+void evf_schedule_callback(uint64_t timestamp_ms, Evf_timer_callback callback)
+{
+    scheduled_callback_timestamp_ms = timestamp_ms;
+    scheduled_callback = callback;
+}
+
+void evf_cancel_scheduled_callback()
+{
+    scheduled_callback = NULL;
+}
+
+void evf_sim_advance(uint64_t num_ms)
+{
+    uint64_t target_timestamp_ms = virtual_timestamp_ms + num_ms;
+
+    do
+    {
+        handle_all_pending_events();
+    } while (call_scheduled_callback_if_due(target_timestamp_ms));
+
+    // The handlers may have been busy (see evf_sim_busy) past the target, the clock never goes back.
+    if (virtual_timestamp_ms < target_timestamp_ms)
+    {
+        virtual_timestamp_ms = target_timestamp_ms;
+    }
+    handle_all_pending_events();
+}
+
+void evf_sim_busy(uint64_t num_ms)
+{
+    virtual_timestamp_ms += num_ms;
+}
+
+uint64_t evf_sim_run_until_idle()
+{
+    uint64_t start_timestamp_ms = virtual_timestamp_ms;
+
+    do
+    {
+        handle_all_pending_events();
+    } while (call_scheduled_callback_if_due(UINT64_MAX));
+
+    return virtual_timestamp_ms - start_timestamp_ms;
+}
+
+void evf_sim_reset()
+{
+    // The EVF caches the scheduled callback's timestamp, so it must be reset along with the port.
+    evf_deinit();
+
+    virtual_timestamp_ms = 0;
+    scheduled_callback = NULL;
+}
@@ -0,0 +1,46 @@
+/**************************************************************************************************
+ * A simulation port with a virtual clock. Time only moves when the application tells it to, so 
+ * timer behaviour (timeouts, periodic timers, shutdown timing etc.) that would take hours in real
+ * time can be exercised in milliseconds, and always with the same results. Link evf_port_sim.c
+ * instead of a real port (e.g. evf_port_linux.c) to use it.
+ *
+ * The simulation is single-threaded: critical sections are no-ops and the scheduled callback (see
+ * evf_schedule_callback) is called from evf_sim_advance/evf_sim_run_until_idle, never by itself.
+ *************************************************************************************************/
+
+#ifndef EVF_PORT_SIM_H
+#define EVF_PORT_SIM_H
+
+#include <stdint.h>
+
+/**************************************************************************************************
+ * Moves the virtual clock forward by num_ms milliseconds. Every scheduled callback that falls 
+ * within that time is called with the clock set to its scheduled timestamp, and the active objects
+ * handle all of their pending events (by calling evf_task) before each callback and at the end. If
+ * the handlers were busy (see evf_sim_busy) past the target, the clock is left where they finished.
+ *************************************************************************************************/
+void evf_sim_advance(uint64_t num_ms);
+
+/**************************************************************************************************
+ * Moves the virtual clock forward by num_ms milliseconds without calling the scheduled callback or
+ * handling any events, as if the caller had been busy for that long. Intended to be called from 
+ * event handlers, to simulate long run-to-completion steps (e.g. to make timers finish late).
+ *************************************************************************************************/
+void evf_sim_busy(uint64_t num_ms);
+
+/**************************************************************************************************
+ * Handles all pending events and fast-forwards the virtual clock through every scheduled callback
+ * until there is nothing left to do. Returns the number of milliseconds that the clock was moved
+ * forward by. Note: this never returns while a periodic timer is running, use evf_sim_advance in
+ * that case.
+ *************************************************************************************************/
+uint64_t evf_sim_run_until_idle();
+
+/**************************************************************************************************
+ * Returns the EVF to its uninitialised state (see evf_deinit), resets the virtual clock to zero and
+ * removes any scheduled callback. Intended to be called between tests, each of which then starts
+ * with evf_init and registers its active objects.
+ *************************************************************************************************/
+void evf_sim_reset();
+
+#endif // EVF_PORT_SIM_H
@@ -0,0 +1,378 @@
+
+#include "evf_record_linux.h"
+#include "evf_port.h"
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#define LOG_MAGIC      0x45564652 // "EVFR"
+#define LOG_VERSION    2
+
+#define NO_ACTIVE_OBJECT_INDEX    0xFFFF
+
+// Records are padded so that every record header is 8-byte aligned within the log.
+#define RECORD_ALIGNMENT    8
+#define ALIGN_UP(num_bytes)    (((num_bytes) + (RECORD_ALIGNMENT - 1)) & ~(size_t)(RECORD_ALIGNMENT - 1))
+
+struct Log_header
+{
+    uint32_t magic;
+    uint32_t version;
+    uint64_t num_bytes_used; // Including this header.
+};
+
+struct Record_header
+{
+    uint64_t timestamp_ms;
+    int32_t type;
+    uint16_t hook_point;
+    uint16_t ao_index;
+    uint32_t num_payload_bytes;
+    uint32_t reserved;
+};
+
+struct Serializer_table_item
+{
+    Evf_record_serializer serialize;
+    Evf_record_deserializer deserialize;
+};
+
+struct Mapped_log
+{
+    int fd;
+    uint8_t * p_base;
+    size_t capacity_bytes;
+};
+
+/**************************************************************************************************
+ * Static Variables
+ *************************************************************************************************/
+
+// Indexed by event type index, see evf_get_event_type_index.
+static struct Serializer_table_item serializer_table[EVF_MAX_NUM_USER_DEFINED_EVENT_TYPES];
+
+static struct Mapped_log record_log = { .fd = -1 };
+static bool is_recording;
+static uint32_t record_num_dropped;
+
+static struct Mapped_log replay_log = { .fd = -1 };
+static enum Evf_replay_mode replay_mode;
+static size_t replay_read_offset;
+static uint64_t replay_start_timestamp;
+static uint64_t replay_first_record_timestamp;
+static uint32_t replay_num_dropped;
+static bool has_replay_failed;
+
+/**************************************************************************************************
+ * Static Functions
+ *************************************************************************************************/
+
+// Returns NULL for event types that are not user-defined or were never added to the index.
+static struct Serializer_table_item * get_serializer_table_item(int32_t type)
+{
+    int32_t event_type_index = evf_get_event_type_index(type);
+    return (event_type_index == -1) ? NULL : &serializer_table[event_type_index];
+}
+
+static struct Log_header * get_log_header(struct Mapped_log const * p_log)
+{
+    return (struct Log_header *)p_log->p_base;
+}
+
+static void mapped_log_close(struct Mapped_log * p_log)
+{
+    if (p_log->p_base != NULL)
+    {
+        munmap(p_log->p_base, p_log->capacity_bytes);
+        p_log->p_base = NULL;
+    }
+    if (p_log->fd != -1)
+    {
+        close(p_log->fd);
+        p_log->fd = -1;
+    }
+}
+
+static struct Evf_event * deserialize_event(int32_t type, void const * p_buffer, uint32_t num_bytes)
+{
+    struct Serializer_table_item const * p_item = get_serializer_table_item(type);
+    if ((p_item == NULL) || (p_item->deserialize == NULL))
+    {
+        return NULL;
+    }
+
+    return p_item->deserialize(p_buffer, num_bytes);
+}
+
+static bool check_event_type_is_recordable(int32_t type)
+{
+    struct Serializer_table_item const * p_item = get_serializer_table_item(type);
+    return (p_item != NULL) && (p_item->serialize != NULL);
+}
+
+/* Timer finished (and request timeout) events are not recorded, since the live timers create them
+ * again when the log is replayed. Injecting recorded ones as well would duplicate them.
+ */
+static bool check_event_is_timer_driven(enum Evf_event_hook_point point, struct Evf_event const * p_event)
+{
+    return (point == EVF_EVENT_HOOK_POINT_TIMER_FINISHED)
+        || (p_event->type == EVF_EVENT_TYPE_REQUEST_TIMEOUT);
+}
+
+// Called from within a critical section (see evf_register_event_hook).
+static void record_event_hook(enum Evf_event_hook_point point,
+                              struct Evf_active_object const * p_ao,
+                              struct Evf_event const * p_event)
+{
+    if (check_event_is_timer_driven(point, p_event))
+    {
+        return;
+    }
+
+    if (!is_recording || !check_event_type_is_recordable(p_event->type))
+    {
+        record_num_dropped++;
+        return;
+    }
+
+    struct Log_header * p_log_header = get_log_header(&record_log);
+    size_t record_offset = p_log_header->num_bytes_used;
+    size_t payload_offset = record_offset + sizeof(struct Record_header);
+    if (payload_offset > record_log.capacity_bytes)
+    {
+        is_recording = false;
+        record_num_dropped++;
+        return;
+    }
+
+    uint32_t buffer_size = (uint32_t)(record_log.capacity_bytes - payload_offset);
+    struct Serializer_table_item const * p_item = get_serializer_table_item(p_event->type);
+    uint32_t num_payload_bytes = p_item->serialize(p_event, record_log.p_base + payload_offset, buffer_size);
+    if (num_payload_bytes > buffer_size)
+    {
+        is_recording = false;
+        record_num_dropped++;
+        return;
+    }
+
+    int32_t ao_index = (p_ao != NULL) ? evf_get_active_object_index(p_ao) : -1;
+    struct Record_header * p_record = (struct Record_header *)(record_log.p_base + record_offset);
+    p_record->timestamp_ms      = evf_get_timestamp_ms();
+    p_record->type              = p_event->type;
+    p_record->hook_point        = (uint16_t)point;
+    p_record->ao_index          = (ao_index < 0) ? NO_ACTIVE_OBJECT_INDEX : (uint16_t)ao_index;
+    p_record->num_payload_bytes = num_payload_bytes;
+    p_record->reserved          = 0;
+
+    // Only commit the record once it is complete so that a crash never leaves a partial record.
+    p_log_header->num_bytes_used = ALIGN_UP(payload_offset + num_payload_bytes);
+}
+
+/* Whether the record at the read offset, including its payload, lies within the used part of the 
+ * log. A log that was cut short (or whose header is corrupt) ends part way through a record.
+ */
+static bool check_replay_record_is_complete(size_t num_bytes_used)
+{
+    if ((num_bytes_used - replay_read_offset) < sizeof(struct Record_header)) { return false; }
+
+    struct Record_header const * p_record = (void const *)(replay_log.p_base + replay_read_offset);
+    return p_record->num_payload_bytes <= (num_bytes_used - replay_read_offset - sizeof(*p_record));
+}
+
+static bool check_replay_record_is_due(struct Record_header const * p_record)
+{
+    if (replay_mode == EVF_REPLAY_MODE_REAL_TIME)
+    {
+        uint64_t elapsed = evf_get_timestamp_ms() - replay_start_timestamp;
+        return (p_record->timestamp_ms - replay_first_record_timestamp) <= elapsed;
+    }
+
+    evf_critical_section_enter();
+    bool is_idle = !evf_check_if_work_to_do();
+    evf_critical_section_exit();
+
+    return is_idle;
+}
+
+static void inject_replay_record(struct Record_header const * p_record)
+{
+    struct Evf_event * p_event = deserialize_event(p_record->type,
+                                                   (uint8_t const *)(p_record + 1),
+                                                   p_record->num_payload_bytes);
+    struct Evf_active_object * p_ao = (p_record->ao_index == NO_ACTIVE_OBJECT_INDEX)
+                                    ? NULL
+                                    : evf_get_active_object_by_index(p_record->ao_index);
+    if (p_event == NULL)
+    {
+        replay_num_dropped++;
+        return;
+    }
+
+    if (p_record->hook_point == EVF_EVENT_HOOK_POINT_PUBLISH)
+    {
+        evf_publish(p_ao, p_event);
+    }
+    else if ((p_ao == NULL) || !evf_post(p_ao, p_event))
+    {
+        evf_free(p_event);
+        replay_num_dropped++;
+    }
+}
+
+/**************************************************************************************************
+ * API function implementations
+ *************************************************************************************************/
+
+void evf_record_register_serializer(int32_t event_type,
+                                    Evf_record_serializer serialize,
+                                    Evf_record_deserializer deserialize)
+{
+    int32_t event_type_index = evf_register_event_type(event_type);
+    evf_assert(event_type_index != -1);
+    serializer_table[event_type_index].serialize = serialize;
+    serializer_table[event_type_index].deserialize = deserialize;
+}
+
+bool evf_record_start(char const * p_path, size_t capacity_bytes)
+{
+    evf_assert(record_log.p_base == NULL);
+    evf_assert(capacity_bytes >= sizeof(struct Log_header));
+
+    record_log.fd = open(p_path, O_RDWR | O_CREAT | O_TRUNC, 0644);
+    if ((record_log.fd == -1) || (ftruncate(record_log.fd, (off_t)capacity_bytes) != 0))
+    {
+        mapped_log_close(&record_log);
+        return false;
+    }
+
+    void * p_base = mmap(NULL, capacity_bytes, PROT_READ | PROT_WRITE, MAP_SHARED, record_log.fd, 0);
+    if (p_base == MAP_FAILED)
+    {
+        mapped_log_close(&record_log);
+        return false;
+    }
+    record_log.p_base = p_base;
+    record_log.capacity_bytes = capacity_bytes;
+
+    struct Log_header * p_log_header = get_log_header(&record_log);
+    p_log_header->magic = LOG_MAGIC;
+    p_log_header->version = LOG_VERSION;
+    p_log_header->num_bytes_used = sizeof(struct Log_header);
+
+    evf_critical_section_enter();
+    record_num_dropped = 0;
+    is_recording = true;
+    evf_register_event_hook(&record_event_hook);
+    evf_critical_section_exit();
+
+    return true;
+}
+
+void evf_record_stop()
+{
+    evf_critical_section_enter();
+    evf_register_event_hook(NULL);
+    is_recording = false;
+    evf_critical_section_exit();
+
+    if (record_log.p_base == NULL) { return; }
+
+    size_t num_bytes_used = get_log_header(&record_log)->num_bytes_used;
+    msync(record_log.p_base, record_log.capacity_bytes, MS_SYNC);
+    munmap(record_log.p_base, record_log.capacity_bytes);
+    record_log.p_base = NULL;
+    (void)ftruncate(record_log.fd, (off_t)num_bytes_used);
+    mapped_log_close(&record_log);
+}
+
+uint32_t evf_record_get_num_dropped()
+{
+    return record_num_dropped;
+}
+
+bool evf_replay_open(char const * p_path, enum Evf_replay_mode mode)
+{
+    evf_assert(replay_log.p_base == NULL);
+
+    struct stat file_info;
+    replay_log.fd = open(p_path, O_RDONLY);
+    if ((replay_log.fd == -1)
+        || (fstat(replay_log.fd, &file_info) != 0)
+        || ((size_t)file_info.st_size < sizeof(struct Log_header)))
+    {
+        mapped_log_close(&replay_log);
+        return false;
+    }
+
+    void * p_base = mmap(NULL, (size_t)file_info.st_size, PROT_READ, MAP_PRIVATE, replay_log.fd, 0);
+    if (p_base == MAP_FAILED)
+    {
+        mapped_log_close(&replay_log);
+        return false;
+    }
+    replay_log.p_base = p_base;
+    replay_log.capacity_bytes = (size_t)file_info.st_size;
+
+    struct Log_header const * p_log_header = get_log_header(&replay_log);
+    if ((p_log_header->magic != LOG_MAGIC)
+        || (p_log_header->version != LOG_VERSION)
+        || (p_log_header->num_bytes_used > replay_log.capacity_bytes))
+    {
+        mapped_log_close(&replay_log);
+        return false;
+    }
+
+    replay_mode = mode;
+    replay_read_offset = sizeof(struct Log_header);
+    replay_num_dropped = 0;
+    has_replay_failed = false;
+    replay_start_timestamp = evf_get_timestamp_ms();
+    replay_first_record_timestamp = 0;
+    if ((replay_read_offset < p_log_header->num_bytes_used)
+        && check_replay_record_is_complete(p_log_header->num_bytes_used))
+    {
+        struct Record_header const * p_first = (void const *)(replay_log.p_base + replay_read_offset);
+        replay_first_record_timestamp = p_first->timestamp_ms;
+    }
+
+    return true;
+}
+
+bool evf_replay_step()
+{
+    if ((replay_log.p_base == NULL) || has_replay_failed) { return false; }
+
+    size_t num_bytes_used = get_log_header(&replay_log)->num_bytes_used;
+    while (replay_read_offset < num_bytes_used)
+    {
+        if (!check_replay_record_is_complete(num_bytes_used))
+        {
+            has_replay_failed = true;
+            return false;
+        }
+
+        struct Record_header const * p_record = (void const *)(replay_log.p_base + replay_read_offset);
+        if (!check_replay_record_is_due(p_record)) { break; }
+
+        inject_replay_record(p_record);
+        replay_read_offset = ALIGN_UP(replay_read_offset + sizeof(*p_record) + p_record->num_payload_bytes);
+    }
+
+    return (replay_read_offset < num_bytes_used);
+}
+
+uint32_t evf_replay_get_num_dropped()
+{
+    return replay_num_dropped;
+}
+
+bool evf_replay_check_has_failed()
+{
+    return has_replay_failed;
+}
+
+void evf_replay_close()
+{
+    mapped_log_close(&replay_log);
+}
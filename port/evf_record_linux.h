@@ -0,0 +1,111 @@
+/**************************************************************************************************
+ * Records the stream of events entering the EVF (posts and publishes) to a memory-mapped log file,
+ * and replays a recorded log back into the EVF. This is intended for deterministic load testing 
+ * and for reproducing bugs that were seen on a production system.
+ *
+ * Each record in the log holds a timestamp (see evf_get_timestamp_ms), the hook point, the index
+ * of the active object involved (see evf_get_active_object_index) and the event type, followed by
+ * the serialized event bytes. Events are serialized/deserialized by user-supplied functions that
+ * are registered per event type. User-defined event types without a registered serializer are not
+ * recorded, so serializers should only be registered for the event types that come from outside
+ * the active objects (the inputs), since the events that active objects send are sent again when
+ * they handle the replayed inputs.
+ *
+ * Timer finished events (and request timeout events) are not recorded: when the log is replayed,
+ * the timers that the active objects start while handling the replayed events finish by themselves.
+ * Replaying in EVF_REPLAY_MODE_REAL_TIME keeps them in the same order relative to the inputs.
+ *
+ * Note: replaying relies on the registration order of the active objects being the same as when
+ * the log was recorded, so logs should only be replayed against builds with the same topology.
+ *************************************************************************************************/
+
+#ifndef EVF_RECORD_LINUX_H
+#define EVF_RECORD_LINUX_H
+
+#include "../evf.h"
+#include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
+
+/* Writes the event data that is needed to re-create the event (not including the Evf_event base)
+ * into p_buffer. Returns the number of bytes that the serialized event takes up. If this is more
+ * than buffer_size then nothing should be written (the log is full).
+ */
+typedef uint32_t (*Evf_record_serializer)(struct Evf_event const * p_event,
+                                          void * p_buffer,
+                                          uint32_t buffer_size);
+
+/* Re-creates an event from the bytes written by the matching serializer. The event must be
+ * allocated using evf_malloc and have its type set. Return NULL if the event cannot be re-created.
+ */
+typedef struct Evf_event * (*Evf_record_deserializer)(void const * p_buffer, uint32_t num_bytes);
+
+enum Evf_replay_mode
+{
+    // Records are injected at the same relative times as they were recorded.
+    EVF_REPLAY_MODE_REAL_TIME,
+
+    /* The next record is injected as soon as there is no work to do, i.e. the effects of each
+     * recorded event are handled fully before the next one is injected.
+     */
+    EVF_REPLAY_MODE_AS_FAST_AS_POSSIBLE,
+};
+
+/**************************************************************************************************
+ * Registers the functions used to record/replay events of a user-defined event type. This must be
+ * done for the same types before both recording and replaying, after evf_init and before evf_task
+ * is first called (see evf_register_event_type).
+ *************************************************************************************************/
+void evf_record_register_serializer(int32_t event_type,
+                                    Evf_record_serializer serialize,
+                                    Evf_record_deserializer deserialize);
+
+/**************************************************************************************************
+ * Creates (or truncates) the log file at p_path, maps capacity_bytes of it into memory and starts
+ * recording. Must be called after evf_init. Returns false if the log file could not be mapped.
+ * Recording stops by itself when the log is full.
+ *************************************************************************************************/
+bool evf_record_start(char const * p_path, size_t capacity_bytes);
+
+/**************************************************************************************************
+ * Stops recording, flushes the log and unmaps it. The file is truncated to the recorded length.
+ *************************************************************************************************/
+void evf_record_stop();
+
+/**************************************************************************************************
+ * The number of events that entered the EVF while recording but could not be recorded, either
+ * because the log was full or because there was no serializer registered for the event type.
+ *************************************************************************************************/
+uint32_t evf_record_get_num_dropped();
+
+/**************************************************************************************************
+ * Maps a recorded log file for replaying. Must be called after the active objects have been
+ * registered. Returns false if the file could not be mapped or is not a valid log.
+ *************************************************************************************************/
+bool evf_replay_open(char const * p_path, enum Evf_replay_mode mode);
+
+/**************************************************************************************************
+ * Injects the recorded events that are due (see Evf_replay_mode) into the EVF. Should be called
+ * in the same loop as evf_task. Returns false once the whole log has been replayed, or once 
+ * replaying has failed (see evf_replay_check_has_failed).
+ *************************************************************************************************/
+bool evf_replay_step();
+
+/**************************************************************************************************
+ * The number of recorded events that could not be injected e.g. because the receiver's queue was
+ * full or the event could not be deserialized.
+ *************************************************************************************************/
+uint32_t evf_replay_get_num_dropped();
+
+/**************************************************************************************************
+ * Whether replaying stopped early because the log ends part way through a record (e.g. it was 
+ * truncated or its header is corrupt). The records before that one have been injected.
+ *************************************************************************************************/
+bool evf_replay_check_has_failed();
+
+/**************************************************************************************************
+ * Unmaps the log that is being replayed.
+ *************************************************************************************************/
+void evf_replay_close();
+
+#endif // EVF_RECORD_LINUX_H
@@ -0,0 +1,122 @@
+/**************************************************************************************************
+ * Benchmarks the hot/cold field order of struct Evf_active_object. It reports...
+ * - Which cache lines the fields used when dispatching events sit on, and where the rarely used
+ *   ones (the name and subscriptions) start.
+ * - Single-threaded dispatch throughput, round-robin over more active objects than fit in L1, so
+ *   that every dispatch has to bring its active object's hot fields in.
+ * Build it on the revisions or configurations to compare (see the bench target in the Makefile)
+ * e.g. make bench_ao_layout && ./bench_ao_layout
+ *************************************************************************************************/
+
+#include "../evf.h"
+#include "../port/evf_port.h"
+#include <stddef.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+
+#define CACHE_LINE_SIZE        64
+#define NUM_ACTIVE_OBJECTS     256
+#define NUM_DISPATCH_ROUNDS    2000
+
+#define REPORT_FIELD(field)                                                                        \
+    printf("  %-24s @ %4zu (line %zu)\n", #field, offsetof(struct Evf_active_object, field),      \
+           offsetof(struct Evf_active_object, field) / CACHE_LINE_SIZE)
+
+enum Bench_event_types
+{
+    EVENT_TYPE_BENCH = EVF_USER_EVENT_TYPES_START,
+};
+
+/**************************************************************************************************
+ * Static Variables
+ *************************************************************************************************/
+
+static uint64_t num_handled;
+
+static struct Evf_active_object bench_aos[NUM_ACTIVE_OBJECTS];
+
+/**************************************************************************************************
+ * Static Functions
+ *************************************************************************************************/
+
+static enum Evf_active_object_status bench_handler(struct Evf_active_object * p_self,
+                                                   struct Evf_event const * p_event)
+{
+    (void)p_self;
+    (void)p_event;
+    num_handled++;
+    return EVF_ACTIVE_OBJECT_STATUS_RUNNING;
+}
+
+static double get_time_s()
+{
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (double)now.tv_sec + ((double)now.tv_nsec / 1e9);
+}
+
+static struct Evf_event * create_bench_event()
+{
+    struct Evf_event * p_event = EVF_EVENT_ALLOC(struct Evf_event);
+    evf_event_set_type(p_event, EVENT_TYPE_BENCH);
+    return p_event;
+}
+
+static void report_layout()
+{
+    printf("Layout (cache line size %d)\n", CACHE_LINE_SIZE);
+    printf("  sizeof(struct Evf_active_object) = %zu\n", sizeof(struct Evf_active_object));
+    REPORT_FIELD(handle_event);
+    REPORT_FIELD(priority);
+    REPORT_FIELD(is_scheduled);
+    REPORT_FIELD(ready_item);
+    REPORT_FIELD(event_queue);
+    REPORT_FIELD(num_rtc_budget_overruns);
+    REPORT_FIELD(name);
+    REPORT_FIELD(event_type_subscriptions);
+}
+
+static void benchmark_dispatch()
+{
+    double start_time_s = get_time_s();
+
+    for (uint32_t round = 0; round < NUM_DISPATCH_ROUNDS; round++)
+    {
+        for (uint32_t i = 0; i < NUM_ACTIVE_OBJECTS; i++)
+        {
+            evf_post(&bench_aos[i], create_bench_event());
+        }
+        while (evf_check_if_work_to_do())
+        {
+            evf_task();
+        }
+    }
+
+    double elapsed_s = get_time_s() - start_time_s;
+    printf("Dispatch: %llu events in %.3f s = %.2f M events/s\n",
+           (unsigned long long)num_handled, elapsed_s, ((double)num_handled / elapsed_s) / 1e6);
+}
+
+int main()
+{
+    report_layout();
+
+    evf_init();
+    for (uint32_t i = 0; i < NUM_ACTIVE_OBJECTS; i++)
+    {
+        // The active objects' fields are const, so they are copied into place.
+        struct Evf_active_object const ao = {
+            .name         = "Bench",
+            .priority     = 1,
+            .handle_event = &bench_handler,
+            .event_type_subscriptions = { EVF_EVENT_TYPE_NULL },
+        };
+        memcpy(&bench_aos[i], &ao, sizeof(ao));
+        evf_register_active_object(&bench_aos[i]);
+    }
+
+    benchmark_dispatch();
+
+    return 0;
+}
@@ -0,0 +1,37 @@
+/**************************************************************************************************
+ * A minimal harness shared by the behavioural tests. Each test is a function that sets up the EVF
+ * itself, runs it (usually on the simulation port, see port/evf_port_sim.h) and checks the results
+ * with EVF_TEST_CHECK. The first failed check, or any sanitizer report, aborts the test program.
+ *************************************************************************************************/
+
+#ifndef EVF_TEST_H
+#define EVF_TEST_H
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#define EVF_TEST_CHECK(condition)                                                      \
+    do                                                                                 \
+    {                                                                                  \
+        if (!(condition))                                                              \
+        {                                                                              \
+            fprintf(stderr, "FAILED: %s:%d: %s\n", __FILE__, __LINE__, #condition);    \
+            abort();                                                                   \
+        }                                                                              \
+    } while (0)
+
+#define EVF_TEST_RUN(test_function)         \
+    do                                      \
+    {                                       \
+        printf("%s\n", #test_function);     \
+        test_function();                    \
+    } while (0)
+
+/* Read by the sanitizers at startup (when a test is built with one). Any report fails the test,
+ * rather than just being printed.
+ */
+char const * __asan_default_options() { return "halt_on_error=1:abort_on_error=1"; }
+char const * __tsan_default_options() { return "halt_on_error=1:abort_on_error=1"; }
+char const * __ubsan_default_options() { return "halt_on_error=1:abort_on_error=1:print_stacktrace=1"; }
+
+#endif // EVF_TEST_H
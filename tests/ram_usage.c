@@ -0,0 +1,27 @@
+/**************************************************************************************************
+ * Prints evf_ram_usage for the EVF configuration that it is built with, see the ram_usage target 
+ * in the Makefile e.g. make ram_usage EVF_CONFIG="-DEVF_COMPACT_MEMORY_ENABLED=1"
+ *************************************************************************************************/
+
+#include "../evf.h"
+#include <stdio.h>
+
+#define PRINT_BYTES(field)    printf("  %-26s %6u\n", #field, (unsigned)evf_ram_usage.field)
+
+int main()
+{
+    printf("EVF RAM usage (bytes)\n");
+    PRINT_BYTES(active_object_bytes);
+    PRINT_BYTES(timer_bytes);
+    PRINT_BYTES(registry_bytes);
+    PRINT_BYTES(subscription_table_bytes);
+    PRINT_BYTES(scheduler_bytes);
+    PRINT_BYTES(event_destructors_bytes);
+    PRINT_BYTES(event_type_index_bytes);
+    PRINT_BYTES(pending_requests_bytes);
+    PRINT_BYTES(isr_deferral_ring_bytes);
+    PRINT_BYTES(other_bytes);
+    PRINT_BYTES(total_bytes);
+
+    return 0;
+}
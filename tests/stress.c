@@ -0,0 +1,384 @@
+/**************************************************************************************************
+ * A contention stress/soak test: producer threads post and publish events concurrently while
+ * evf_task runs on the main thread, for 1, 2, 4... up to max_producers threads e.g.
+ * make stress (built with ThreadSanitizer, or make stress SANITIZER=address)
+ * ./stress [max_producers] [events_per_s_per_producer] [fan_out] [duration_s]
+ *
+ * A rate of 0 means as fast as possible. Each producer alternates between posting to one receiver
+ * and publishing to all fan_out receivers. For every run it checks...
+ * - Exactly-once, in-order delivery: every receiver gets every event meant for it once, in the
+ *   order that each producer sent them.
+ * - That the reference counts balance: every event is destroyed exactly once, with a reference
+ *   count of 0, and none are left over.
+ * It reports the throughput (handled events/s) and the post/publish to handling latency
+ * percentiles. Any failed check, or any sanitizer report, aborts.
+ *
+ * Note: the number of events in flight is limited to EVF_EVENT_QUEUE_LENGTH, so that no queue can
+ * overflow (publishing drops events for full queues, which would look like lost events).
+ *************************************************************************************************/
+
+#define _GNU_SOURCE // For clock_nanosleep.
+
+#include "../evf.h"
+#include "../port/evf_port.h"
+#include "../port/evf_port_linux.h"
+#include "evf_test.h"
+#include <pthread.h>
+#include <sched.h>
+#include <stdatomic.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#define MAX_NUM_PRODUCERS        16
+#define MAX_NUM_RECEIVERS        16
+#define MAX_LATENCY_SAMPLES      (1 << 20)
+
+#define EVENT_MAGIC_LIVE         0x4C495645 // "LIVE"
+#define EVENT_MAGIC_DESTROYED    0x44454144 // "DEAD"
+
+enum Stress_event_types
+{
+    EVENT_TYPE_STRESS_POSTED = EVF_USER_EVENT_TYPES_START,
+    EVENT_TYPE_STRESS_PUBLISHED,
+    EVENT_TYPE_STRESS_PRODUCER_DONE,
+};
+
+struct Stress_event
+{
+    struct Evf_event base;
+    uint32_t magic;
+    uint32_t producer_id;
+    uint64_t sequence_number;
+    uint64_t sent_timestamp_ns;
+};
+
+struct Producer
+{
+    pthread_t thread;
+    uint32_t id;
+    uint64_t num_posted;
+    uint64_t num_published;
+};
+
+// Per receiver, the sequence number that is expected next from each producer.
+struct Receiver_active_object
+{
+    struct Evf_active_object base;
+    uint64_t next_posted_sequence_numbers[MAX_NUM_PRODUCERS];
+    uint64_t next_published_sequence_numbers[MAX_NUM_PRODUCERS];
+};
+
+/**************************************************************************************************
+ * Static Variables
+ *************************************************************************************************/
+
+static uint32_t max_num_producers = 8;
+static uint32_t events_per_s_per_producer = 0;
+static uint32_t fan_out = 4;
+static uint32_t duration_s = 2;
+
+static struct Receiver_active_object receivers[MAX_NUM_RECEIVERS];
+static struct Producer producers[MAX_NUM_PRODUCERS];
+
+static atomic_bool is_run_in_progress;
+static atomic_uint_fast64_t num_events_created;
+static atomic_uint_fast64_t num_events_destroyed;
+static atomic_int_fast64_t num_events_in_flight;
+static atomic_uint_fast64_t num_backpressure_waits;
+
+// Only accessed on the main (evf_task) thread.
+static uint32_t num_producers_running;
+static uint64_t num_events_handled;
+static uint64_t latency_samples_ns[MAX_LATENCY_SAMPLES];
+static uint32_t num_latency_samples;
+
+/**************************************************************************************************
+ * Static Functions
+ *************************************************************************************************/
+
+static uint64_t get_time_ns()
+{
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return ((uint64_t)now.tv_sec * 1000000000) + (uint64_t)now.tv_nsec;
+}
+
+static void check(bool condition, char const * p_what)
+{
+    if (!condition)
+    {
+        fprintf(stderr, "FAILED: %s\n", p_what);
+        abort();
+    }
+}
+
+// Runs on whichever thread destroys the last reference.
+static void stress_event_destructor(struct Evf_event * p_event)
+{
+    struct Stress_event * p_stress_event = (struct Stress_event *)p_event;
+    check(p_stress_event->magic == EVENT_MAGIC_LIVE, "event destroyed twice");
+    check(p_event->ref_count == 0, "event destroyed with references left");
+
+    p_stress_event->magic = EVENT_MAGIC_DESTROYED;
+    atomic_fetch_add(&num_events_destroyed, 1);
+    atomic_fetch_sub(&num_events_in_flight, 1);
+}
+
+static void record_latency(struct Stress_event const * p_event)
+{
+    if (num_latency_samples < MAX_LATENCY_SAMPLES)
+    {
+        latency_samples_ns[num_latency_samples++] = get_time_ns() - p_event->sent_timestamp_ns;
+    }
+}
+
+static enum Evf_active_object_status receiver_handler(struct Evf_active_object * p_self,
+                                                      struct Evf_event const * p_event)
+{
+    struct Receiver_active_object * p_receiver = (struct Receiver_active_object *)p_self;
+    struct Stress_event const * p_stress_event = (struct Stress_event const *)p_event;
+    check(p_stress_event->magic == EVENT_MAGIC_LIVE, "handled an event that was already destroyed");
+    check(p_stress_event->producer_id < MAX_NUM_PRODUCERS, "corrupt producer ID");
+
+    uint64_t * p_next_sequence_number = NULL;
+    switch (p_event->type)
+    {
+        case EVENT_TYPE_STRESS_POSTED:
+            p_next_sequence_number = &p_receiver->next_posted_sequence_numbers[p_stress_event->producer_id];
+            break;
+        case EVENT_TYPE_STRESS_PUBLISHED:
+            p_next_sequence_number = &p_receiver->next_published_sequence_numbers[p_stress_event->producer_id];
+            break;
+        case EVENT_TYPE_STRESS_PRODUCER_DONE:
+            num_producers_running--;
+            return EVF_ACTIVE_OBJECT_STATUS_RUNNING;
+        default:
+            check(false, "unexpected event type");
+    }
+
+    // A gap is a lost event, a repeat is a duplicate and anything else is out of order.
+    check(p_stress_event->sequence_number >= *p_next_sequence_number, "duplicate or out-of-order event");
+    check(p_stress_event->sequence_number == *p_next_sequence_number, "lost event");
+    (*p_next_sequence_number)++;
+
+    num_events_handled++;
+    record_latency(p_stress_event);
+
+    return EVF_ACTIVE_OBJECT_STATUS_RUNNING;
+}
+
+static struct Stress_event * create_stress_event(int32_t type, uint32_t producer_id, uint64_t sequence_number)
+{
+    // Back pressure, so that no receiver's queue can overflow (see the note at the top).
+    int_fast64_t num_in_flight = atomic_load(&num_events_in_flight);
+    while ((num_in_flight >= EVF_EVENT_QUEUE_LENGTH)
+        || !atomic_compare_exchange_weak(&num_events_in_flight, &num_in_flight, num_in_flight + 1))
+    {
+        if (num_in_flight >= EVF_EVENT_QUEUE_LENGTH)
+        {
+            atomic_fetch_add_explicit(&num_backpressure_waits, 1, memory_order_relaxed);
+            sched_yield();
+            num_in_flight = atomic_load(&num_events_in_flight);
+        }
+    }
+    atomic_fetch_add(&num_events_created, 1);
+
+    struct Stress_event * p_event = EVF_EVENT_ALLOC(struct Stress_event);
+    check(p_event != NULL, "out of memory");
+    evf_event_set_type(p_event, type);
+    p_event->magic = EVENT_MAGIC_LIVE;
+    p_event->producer_id = producer_id;
+    p_event->sequence_number = sequence_number;
+    p_event->sent_timestamp_ns = get_time_ns();
+
+    return p_event;
+}
+
+static void post_until_accepted(struct Evf_active_object * p_receiver, struct Stress_event * p_event)
+{
+    // Should be accepted first time, because of the back pressure.
+    while (!evf_post(p_receiver, &p_event->base))
+    {
+        sched_yield();
+    }
+}
+
+static void * producer_thread_main(void * p_arg)
+{
+    struct Producer * p_producer = p_arg;
+    struct Evf_active_object * p_post_receiver = &receivers[p_producer->id % fan_out].base;
+    uint64_t interval_ns = (events_per_s_per_producer > 0) ? (1000000000ull / events_per_s_per_producer) : 0;
+    uint64_t next_send_ns = get_time_ns();
+
+    while (atomic_load_explicit(&is_run_in_progress, memory_order_relaxed))
+    {
+        if (interval_ns > 0)
+        {
+            next_send_ns += interval_ns;
+            struct timespec const next_send = {
+                .tv_sec = (time_t)(next_send_ns / 1000000000),
+                .tv_nsec = (long)(next_send_ns % 1000000000),
+            };
+            clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &next_send, NULL);
+        }
+
+        if (((p_producer->num_posted + p_producer->num_published) % 2) == 0)
+        {
+            post_until_accepted(p_post_receiver,
+                                create_stress_event(EVENT_TYPE_STRESS_POSTED, p_producer->id, p_producer->num_posted));
+            p_producer->num_posted++;
+        }
+        else
+        {
+            evf_publish(NULL, &create_stress_event(EVENT_TYPE_STRESS_PUBLISHED, p_producer->id,
+                                                   p_producer->num_published)->base);
+            p_producer->num_published++;
+        }
+    }
+
+    // Also wakes the main thread, in case it's waiting for work.
+    post_until_accepted(&receivers[0].base,
+                        create_stress_event(EVENT_TYPE_STRESS_PRODUCER_DONE, p_producer->id, 0));
+
+    return NULL;
+}
+
+static int compare_uint64(void const * p_a, void const * p_b)
+{
+    uint64_t a = *(uint64_t const *)p_a;
+    uint64_t b = *(uint64_t const *)p_b;
+    return (a > b) - (a < b);
+}
+
+static double get_latency_percentile_us(double percentile)
+{
+    uint32_t index = (uint32_t)((percentile / 100.0) * (double)(num_latency_samples - 1));
+    return (double)latency_samples_ns[index] / 1000.0;
+}
+
+static void reset_run_state()
+{
+    for (uint32_t i = 0; i < fan_out; i++)
+    {
+        memset(receivers[i].next_posted_sequence_numbers, 0, sizeof(receivers[i].next_posted_sequence_numbers));
+        memset(receivers[i].next_published_sequence_numbers, 0, sizeof(receivers[i].next_published_sequence_numbers));
+    }
+    memset(producers, 0, sizeof(producers));
+
+    atomic_store(&num_events_created, 0);
+    atomic_store(&num_events_destroyed, 0);
+    atomic_store(&num_backpressure_waits, 0);
+    num_events_handled = 0;
+    num_latency_samples = 0;
+}
+
+static void check_run_results(uint32_t num_producers)
+{
+    for (uint32_t i = 0; i < num_producers; i++)
+    {
+        struct Producer const * p_producer = &producers[i];
+        check(receivers[i % fan_out].next_posted_sequence_numbers[i] == p_producer->num_posted,
+              "lost posted events");
+        for (uint32_t j = 0; j < fan_out; j++)
+        {
+            check(receivers[j].next_published_sequence_numbers[i] == p_producer->num_published,
+                  "lost published events");
+        }
+    }
+
+    check(atomic_load(&num_events_in_flight) == 0, "events left in flight");
+    check(atomic_load(&num_events_created) == atomic_load(&num_events_destroyed),
+          "events created != events destroyed");
+}
+
+static void run(uint32_t num_producers)
+{
+    reset_run_state();
+    num_producers_running = num_producers;
+    atomic_store(&is_run_in_progress, true);
+
+    uint64_t start_ns = get_time_ns();
+    for (uint32_t i = 0; i < num_producers; i++)
+    {
+        producers[i].id = i;
+        check(pthread_create(&producers[i].thread, NULL, &producer_thread_main, &producers[i]) == 0,
+              "couldn't create producer thread");
+    }
+
+    while ((num_producers_running > 0) || (atomic_load(&num_events_in_flight) > 0))
+    {
+        if (atomic_load_explicit(&is_run_in_progress, memory_order_relaxed)
+            && ((get_time_ns() - start_ns) >= ((uint64_t)duration_s * 1000000000)))
+        {
+            atomic_store(&is_run_in_progress, false);
+        }
+
+        evf_linux_wait_for_work();
+        evf_task();
+    }
+    double elapsed_s = (double)(get_time_ns() - start_ns) / 1e9;
+
+    for (uint32_t i = 0; i < num_producers; i++)
+    {
+        pthread_join(producers[i].thread, NULL);
+    }
+
+    check_run_results(num_producers);
+
+    qsort(latency_samples_ns, num_latency_samples, sizeof(latency_samples_ns[0]), &compare_uint64);
+    printf("%2u producers: %10llu events, %7.3f M events/s, latency us p50 %8.1f p99 %8.1f "
+           "p99.9 %8.1f max %9.1f, back pressure waits %llu\n",
+           num_producers,
+           (unsigned long long)num_events_handled,
+           ((double)num_events_handled / elapsed_s) / 1e6,
+           get_latency_percentile_us(50.0),
+           get_latency_percentile_us(99.0),
+           get_latency_percentile_us(99.9),
+           get_latency_percentile_us(100.0),
+           (unsigned long long)atomic_load(&num_backpressure_waits));
+}
+
+int main(int argc, char ** argv)
+{
+    if (argc > 1) { max_num_producers = (uint32_t)atoi(argv[1]); }
+    if (argc > 2) { events_per_s_per_producer = (uint32_t)atoi(argv[2]); }
+    if (argc > 3) { fan_out = (uint32_t)atoi(argv[3]); }
+    if (argc > 4) { duration_s = (uint32_t)atoi(argv[4]); }
+    check((max_num_producers > 0) && (max_num_producers <= MAX_NUM_PRODUCERS), "max_producers out of range");
+    check((fan_out > 0) && (fan_out <= MAX_NUM_RECEIVERS), "fan_out out of range");
+
+    printf("Up to %u producers at %u events/s each (0 = unlimited), fan-out %u, %u s per run, "
+           "queue length %d\n",
+           max_num_producers, events_per_s_per_producer, fan_out, duration_s, EVF_EVENT_QUEUE_LENGTH);
+
+    evf_init();
+    for (uint32_t i = 0; i < fan_out; i++)
+    {
+        // The active objects' fields are const, so they are copied into place.
+        struct Evf_active_object const ao = {
+            .name = "Receiver",
+            .handle_event = &receiver_handler,
+            .priority = 1,
+            .event_type_subscriptions = { EVENT_TYPE_STRESS_PUBLISHED, EVF_EVENT_TYPE_NULL },
+        };
+        memcpy(&receivers[i].base, &ao, sizeof(ao));
+        evf_register_active_object(&receivers[i].base);
+    }
+    evf_register_event_destructor(EVENT_TYPE_STRESS_POSTED, &stress_event_destructor);
+    evf_register_event_destructor(EVENT_TYPE_STRESS_PUBLISHED, &stress_event_destructor);
+    evf_register_event_destructor(EVENT_TYPE_STRESS_PRODUCER_DONE, &stress_event_destructor);
+
+    // Doubling the number of producers each run, always finishing with a run at max_producers.
+    uint32_t num_producers = 1;
+    while (true)
+    {
+        run(num_producers);
+        if (num_producers == max_num_producers) { break; }
+        num_producers = ((num_producers * 2) < max_num_producers) ? (num_producers * 2) : max_num_producers;
+    }
+
+    printf("PASSED\n");
+    return 0;
+}
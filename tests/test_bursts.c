@@ -0,0 +1,142 @@
+/**************************************************************************************************
+ * Burst quanta with the fixed priority scheduling policy, on the simulation port: active objects
+ * of the same priority take turns in a weighted round-robin, and a higher priority active object
+ * that becomes ready cuts a burst short.
+ *************************************************************************************************/
+
+#include "../evf.h"
+#include "../port/evf_port.h"
+#include "../port/evf_port_sim.h"
+#include "evf_test.h"
+
+#define MAX_NUM_HANDLED    16
+
+enum Test_event_types
+{
+    EVENT_TYPE_WORK = EVF_USER_EVENT_TYPES_START,
+};
+
+/**************************************************************************************************
+ * Static Variables
+ *************************************************************************************************/
+
+// The name of the active object that handled each event, in order e.g. "AAAB".
+static char handled_by[MAX_NUM_HANDLED + 1];
+static uint32_t num_handled;
+
+// The event (by number) on which the heavy worker posts to the urgent one, 0 for none.
+static uint32_t urgent_post_at;
+
+static enum Evf_active_object_status worker_handler(struct Evf_active_object * p_self,
+                                                    struct Evf_event const * p_event);
+
+static struct Evf_active_object heavy_worker = {
+    .name          = "A",
+    .priority      = 1,
+    .burst_quantum = 3,
+    .handle_event  = &worker_handler,
+    .event_type_subscriptions = { EVF_EVENT_TYPE_NULL },
+};
+
+static struct Evf_active_object light_worker = {
+    .name          = "B",
+    .priority      = 1,
+    .handle_event  = &worker_handler,
+    .event_type_subscriptions = { EVF_EVENT_TYPE_NULL },
+};
+
+static struct Evf_active_object urgent_worker = {
+    .name          = "U",
+    .priority      = 0,
+    .handle_event  = &worker_handler,
+    .event_type_subscriptions = { EVF_EVENT_TYPE_NULL },
+};
+
+/**************************************************************************************************
+ * Static Functions
+ *************************************************************************************************/
+
+static void post_work(struct Evf_active_object * p_receiver, uint32_t num_events)
+{
+    for (uint32_t i = 0; i < num_events; i++)
+    {
+        struct Evf_event * p_event = EVF_EVENT_ALLOC(struct Evf_event);
+        evf_event_set_type(p_event, EVENT_TYPE_WORK);
+        EVF_TEST_CHECK(evf_post(p_receiver, p_event));
+    }
+}
+
+static enum Evf_active_object_status worker_handler(struct Evf_active_object * p_self,
+                                                    struct Evf_event const * p_event)
+{
+    (void)p_event;
+    EVF_TEST_CHECK(num_handled < MAX_NUM_HANDLED);
+    handled_by[num_handled++] = p_self->name[0];
+
+    if ((p_self == &heavy_worker) && (num_handled == urgent_post_at))
+    {
+        post_work(&urgent_worker, 1);
+    }
+
+    return EVF_ACTIVE_OBJECT_STATUS_RUNNING;
+}
+
+static void set_up()
+{
+    evf_sim_reset();
+    for (uint32_t i = 0; i <= MAX_NUM_HANDLED; i++) { handled_by[i] = '\0'; }
+    num_handled = 0;
+    urgent_post_at = 0;
+
+    evf_init();
+    evf_register_active_object(&heavy_worker);
+    evf_register_active_object(&light_worker);
+    evf_register_active_object(&urgent_worker);
+}
+
+static void check_handled_by(char const * p_expected)
+{
+    for (uint32_t i = 0; i <= MAX_NUM_HANDLED; i++)
+    {
+        EVF_TEST_CHECK(handled_by[i] == p_expected[i]);
+        if (p_expected[i] == '\0') { break; }
+    }
+}
+
+/**************************************************************************************************
+ * Tests
+ *************************************************************************************************/
+
+// A handles up to 3 events per turn, B (the default quantum) 1, and whoever runs out stops taking turns.
+static void test_weighted_round_robin()
+{
+    set_up();
+    post_work(&heavy_worker, 6);
+    post_work(&light_worker, 6);
+    evf_sim_run_until_idle();
+
+    check_handled_by("AAABAAABBBBB");
+}
+
+/* The urgent worker becomes ready in the middle of A's burst, and is scheduled straight away. A then
+ * goes to the back of its ready list, behind B.
+ */
+static void test_higher_priority_cuts_burst_short()
+{
+    set_up();
+    urgent_post_at = 2;
+    post_work(&heavy_worker, 4);
+    post_work(&light_worker, 1);
+    evf_sim_run_until_idle();
+
+    check_handled_by("AAUBAA");
+}
+
+int main()
+{
+    EVF_TEST_RUN(test_weighted_round_robin);
+    EVF_TEST_RUN(test_higher_priority_cuts_burst_short);
+
+    printf("PASSED\n");
+    return 0;
+}
@@ -0,0 +1,142 @@
+/**************************************************************************************************
+ * Compact memory mode (see EVF_COMPACT_MEMORY_ENABLED) on the simulation port. Built with the
+ * longest queue that still has 8-bit indices and with more active objects than fit in one word of
+ * a subscriber bitset, so that both limits are exercised.
+ *************************************************************************************************/
+
+#include "../evf.h"
+#include "../port/evf_port.h"
+#include "../port/evf_port_sim.h"
+#include "evf_test.h"
+#include <string.h>
+
+_Static_assert(sizeof(Evf_queue_index) == 1, "The test expects 8-bit queue indices");
+_Static_assert(EVF_EVENT_QUEUE_LENGTH == 128, "The test expects the longest queue with 8-bit indices");
+_Static_assert(EVF_MAX_NUM_ACTIVE_OBJECTS > 32, "The test expects more than one bitset word");
+
+// The size of an active object in the default mode (see test_compact_memory_reference.c).
+extern size_t const reference_active_object_bytes;
+
+enum Test_event_types
+{
+    EVENT_TYPE_PING = EVF_USER_EVENT_TYPES_START,
+};
+
+/**************************************************************************************************
+ * Static Variables
+ *************************************************************************************************/
+
+static enum Evf_active_object_status counting_handler(struct Evf_active_object * p_self,
+                                                      struct Evf_event const * p_event);
+
+// Every one of them subscribes to pings.
+static struct Evf_active_object listeners[EVF_MAX_NUM_ACTIVE_OBJECTS];
+
+static uint32_t num_handled[EVF_MAX_NUM_ACTIVE_OBJECTS];
+
+/**************************************************************************************************
+ * Static Functions
+ *************************************************************************************************/
+
+static enum Evf_active_object_status counting_handler(struct Evf_active_object * p_self,
+                                                      struct Evf_event const * p_event)
+{
+    (void)p_event;
+    num_handled[p_self - listeners]++;
+    return EVF_ACTIVE_OBJECT_STATUS_RUNNING;
+}
+
+static void set_up()
+{
+    evf_sim_reset();
+    evf_init();
+    for (uint32_t i = 0; i < EVF_MAX_NUM_ACTIVE_OBJECTS; i++)
+    {
+        struct Evf_active_object const listener = {
+            .name         = "Listener",
+            .priority     = 1,
+            .handle_event = &counting_handler,
+            .event_type_subscriptions = { EVENT_TYPE_PING, EVF_EVENT_TYPE_NULL },
+        };
+        memcpy(&listeners[i], &listener, sizeof(listener));
+        evf_register_active_object(&listeners[i]);
+        num_handled[i] = 0;
+    }
+}
+
+static struct Evf_event * create_ping()
+{
+    struct Evf_event * p_event = EVF_EVENT_ALLOC(struct Evf_event);
+    evf_event_set_type(p_event, EVENT_TYPE_PING);
+    return p_event;
+}
+
+/**************************************************************************************************
+ * Tests
+ *************************************************************************************************/
+
+// The 8-bit indices wrap around many times, and a full queue is still told apart from an empty one.
+static void test_queue_indices_wrap_around()
+{
+    set_up();
+    for (uint32_t round = 0; round < 5; round++)
+    {
+        for (uint32_t i = 0; i < EVF_EVENT_QUEUE_LENGTH - round; i++)
+        {
+            EVF_TEST_CHECK(evf_post(&listeners[0], create_ping()));
+        }
+        if (round == 0)
+        {
+            struct Evf_event * p_event = create_ping();
+            EVF_TEST_CHECK(!evf_post(&listeners[0], p_event));
+            evf_free(p_event);
+        }
+
+        evf_sim_run_until_idle();
+        EVF_TEST_CHECK(!evf_check_if_work_to_do());
+    }
+
+    EVF_TEST_CHECK(num_handled[0] == (5 * EVF_EVENT_QUEUE_LENGTH) - (0 + 1 + 2 + 3 + 4));
+}
+
+// Every subscriber, in both bitset words, gets a published event except for its publisher.
+static void test_publish_reaches_every_subscriber()
+{
+    set_up();
+    evf_publish(&listeners[33], create_ping());
+    evf_publish(NULL, create_ping());
+    evf_sim_run_until_idle();
+
+    for (uint32_t i = 0; i < EVF_MAX_NUM_ACTIVE_OBJECTS; i++)
+    {
+        EVF_TEST_CHECK(num_handled[i] == ((i == 33) ? 1 : 2));
+    }
+}
+
+static void test_ram_usage_adds_up()
+{
+    struct Evf_ram_usage const * p_usage = &evf_ram_usage;
+    EVF_TEST_CHECK(p_usage->subscription_table_bytes
+        == EVF_MAX_NUM_USER_DEFINED_EVENT_TYPES * ((EVF_MAX_NUM_ACTIVE_OBJECTS + 31) / 32) * sizeof(uint32_t));
+    EVF_TEST_CHECK(p_usage->total_bytes
+        == p_usage->registry_bytes + p_usage->subscription_table_bytes + p_usage->scheduler_bytes
+            + p_usage->event_destructors_bytes + p_usage->event_type_index_bytes
+            + p_usage->pending_requests_bytes + p_usage->isr_deferral_ring_bytes + p_usage->other_bytes);
+}
+
+// The smaller queue indices pack in with the other small fields, rather than being padded out.
+static void test_active_objects_are_smaller()
+{
+    EVF_TEST_CHECK(evf_ram_usage.active_object_bytes < reference_active_object_bytes);
+}
+
+int main()
+{
+    EVF_TEST_RUN(test_queue_indices_wrap_around);
+    EVF_TEST_RUN(test_publish_reaches_every_subscriber);
+    EVF_TEST_RUN(test_ram_usage_adds_up);
+    EVF_TEST_RUN(test_active_objects_are_smaller);
+
+    printf("PASSED\n");
+    return 0;
+}
@@ -0,0 +1,11 @@
+/**************************************************************************************************
+ * Built with test_compact_memory's configuration, but without EVF_COMPACT_MEMORY_ENABLED, so that
+ * the test can compare the sizes against the default mode's.
+ *************************************************************************************************/
+
+#include "../evf.h"
+#include <stddef.h>
+
+_Static_assert(EVF_COMPACT_MEMORY_ENABLED == 0, "The reference must be built in the default mode");
+
+size_t const reference_active_object_bytes = sizeof(struct Evf_active_object);
@@ -0,0 +1,199 @@
+/**************************************************************************************************
+ * Coroutine active objects (see evf_coroutine.h) on the simulation port. Events that arrive while
+ * a coroutine is awaiting something else are deferred: the coroutine is not scheduled for them, and
+ * they are handled, in order, once it awaits them. Built for both scheduling policies.
+ *************************************************************************************************/
+
+#include "../evf.h"
+#include "../evf_coroutine.h"
+#include "../port/evf_port.h"
+#include "../port/evf_port_sim.h"
+#include "evf_test.h"
+
+#define MAX_NUM_HANDLED    16
+
+#define ACK_TIMEOUT_MS    50
+
+enum Test_event_types
+{
+    EVENT_TYPE_ACK = EVF_USER_EVENT_TYPES_START,
+    EVENT_TYPE_DATA,
+};
+
+struct Event_data
+{
+    struct Evf_event base;
+    uint32_t value;
+};
+
+struct Handled_event
+{
+    uint64_t timestamp_ms;
+    int32_t type;
+    uint32_t value; // For data events.
+    bool has_timed_out;
+};
+
+// Awaits an ack (or a timeout), and then two data events.
+struct Receiver_active_object
+{
+    struct Evf_coroutine_active_object base;
+    uint32_t num_data_received;
+};
+
+/**************************************************************************************************
+ * Static Variables
+ *************************************************************************************************/
+
+static struct Handled_event handled[MAX_NUM_HANDLED];
+static uint32_t num_handled;
+static uint32_t num_dispatches;
+
+static enum Evf_active_object_status receiver_run(struct Evf_coroutine_active_object * p_self,
+                                                  struct Evf_event const * p_event);
+
+static struct Receiver_active_object receiver = {
+    .base = {
+        .base = {
+            .name         = "Receiver",
+            .priority     = 1,
+            .handle_event = &evf_coroutine_dispatch,
+            .event_type_subscriptions = { EVF_EVENT_TYPE_NULL },
+        },
+        .body = &receiver_run,
+    },
+};
+
+/**************************************************************************************************
+ * Static Functions
+ *************************************************************************************************/
+
+static enum Evf_active_object_status receiver_run(struct Evf_coroutine_active_object * p_self,
+                                                  struct Evf_event const * p_event)
+{
+    struct Receiver_active_object * p_receiver = (struct Receiver_active_object *)p_self;
+    num_dispatches++;
+    if (p_event != NULL)
+    {
+        EVF_TEST_CHECK(num_handled < MAX_NUM_HANDLED);
+        handled[num_handled++] = (struct Handled_event){
+            .timestamp_ms  = evf_get_timestamp_ms(),
+            .type          = p_event->type,
+            .value         = (p_event->type == EVENT_TYPE_DATA) ? ((struct Event_data const *)p_event)->value : 0,
+            .has_timed_out = evf_coroutine_check_timed_out(p_self),
+        };
+    }
+
+    EVF_COROUTINE_BEGIN(p_self);
+    EVF_AWAIT_EVENT_OR_TIMEOUT(p_self, EVENT_TYPE_ACK, ACK_TIMEOUT_MS);
+    for (p_receiver->num_data_received = 0; p_receiver->num_data_received < 2; p_receiver->num_data_received++)
+    {
+        EVF_AWAIT_EVENT(p_self, EVENT_TYPE_DATA);
+    }
+    EVF_COROUTINE_END(p_self);
+}
+
+static void set_up()
+{
+    evf_sim_reset();
+    num_handled = 0;
+    num_dispatches = 0;
+
+    evf_init();
+    evf_register_active_object(&receiver.base.base);
+    evf_coroutine_init(&receiver.base);
+}
+
+static void post(int32_t type, uint32_t value)
+{
+    struct Event_data * p_event = EVF_EVENT_ALLOC(struct Event_data);
+    evf_event_set_type(p_event, type);
+    p_event->value = value;
+    EVF_TEST_CHECK(evf_post(&receiver.base.base, &p_event->base));
+}
+
+static void check_handled(uint32_t index, uint64_t timestamp_ms, int32_t type, uint32_t value)
+{
+    EVF_TEST_CHECK(index < num_handled);
+    EVF_TEST_CHECK(handled[index].timestamp_ms == timestamp_ms);
+    EVF_TEST_CHECK(handled[index].type == type);
+    EVF_TEST_CHECK(handled[index].value == value);
+}
+
+/**************************************************************************************************
+ * Tests
+ *************************************************************************************************/
+
+// Data that arrives before the ack waits in the queue, without the receiver being scheduled for it.
+static void test_events_are_deferred_while_awaiting()
+{
+    set_up();
+    EVF_TEST_CHECK(num_dispatches == 1);
+
+    post(EVENT_TYPE_DATA, 1);
+    post(EVENT_TYPE_DATA, 2);
+    EVF_TEST_CHECK(!evf_check_if_work_to_do());
+    evf_sim_advance(10);
+    EVF_TEST_CHECK(num_dispatches == 1);
+    EVF_TEST_CHECK(num_handled == 0);
+
+    post(EVENT_TYPE_ACK, 0);
+    EVF_TEST_CHECK(evf_check_if_work_to_do());
+    evf_sim_run_until_idle();
+
+    EVF_TEST_CHECK(num_handled == 3);
+    check_handled(0, 10, EVENT_TYPE_ACK, 0);
+    EVF_TEST_CHECK(!handled[0].has_timed_out);
+    check_handled(1, 10, EVENT_TYPE_DATA, 1);
+    check_handled(2, 10, EVENT_TYPE_DATA, 2);
+    EVF_TEST_CHECK(receiver.base.is_finished);
+}
+
+// The awaited event is taken from behind the deferred ones, which keep their order.
+static void test_deferred_events_keep_their_order()
+{
+    set_up();
+    post(EVENT_TYPE_DATA, 1);
+    post(EVENT_TYPE_ACK, 0);
+    post(EVENT_TYPE_DATA, 2);
+    evf_sim_run_until_idle();
+
+    EVF_TEST_CHECK(num_handled == 3);
+    check_handled(0, 0, EVENT_TYPE_ACK, 0);
+    check_handled(1, 0, EVENT_TYPE_DATA, 1);
+    check_handled(2, 0, EVENT_TYPE_DATA, 2);
+}
+
+// A timeout ends the await too, and the deferred events are still there afterwards.
+static void test_deferred_events_survive_timeout()
+{
+    set_up();
+    post(EVENT_TYPE_DATA, 1);
+    evf_sim_advance(ACK_TIMEOUT_MS - 1);
+    EVF_TEST_CHECK(num_handled == 0);
+
+    evf_sim_advance(1);
+    EVF_TEST_CHECK(num_handled == 2);
+    EVF_TEST_CHECK(handled[0].type == EVF_EVENT_TYPE_TIMER_FINISHED);
+    EVF_TEST_CHECK(handled[0].has_timed_out);
+    check_handled(1, ACK_TIMEOUT_MS, EVENT_TYPE_DATA, 1);
+
+    // An ack after the timeout is not awaited any more, so it stays deferred.
+    post(EVENT_TYPE_ACK, 0);
+    EVF_TEST_CHECK(!evf_check_if_work_to_do());
+    post(EVENT_TYPE_DATA, 2);
+    evf_sim_run_until_idle();
+    EVF_TEST_CHECK(num_handled == 3);
+    check_handled(2, ACK_TIMEOUT_MS, EVENT_TYPE_DATA, 2);
+    EVF_TEST_CHECK(receiver.base.is_finished);
+}
+
+int main()
+{
+    EVF_TEST_RUN(test_events_are_deferred_while_awaiting);
+    EVF_TEST_RUN(test_deferred_events_keep_their_order);
+    EVF_TEST_RUN(test_deferred_events_survive_timeout);
+
+    printf("PASSED\n");
+    return 0;
+}
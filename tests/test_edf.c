@@ -0,0 +1,201 @@
+/**************************************************************************************************
+ * The earliest deadline first scheduling policy on the simulation port: which active object
+ * handles an event next, default and explicit deadlines, and deadline misses.
+ *************************************************************************************************/
+
+#include "../evf.h"
+#include "../port/evf_port.h"
+#include "../port/evf_port_sim.h"
+#include "evf_test.h"
+
+#define MAX_NUM_HANDLED    16
+
+enum Test_event_types
+{
+    EVENT_TYPE_WORK = EVF_USER_EVENT_TYPES_START,
+};
+
+struct Event_work
+{
+    struct Evf_event base;
+    uint32_t id;
+    uint32_t duration_ms;
+};
+
+/**************************************************************************************************
+ * Static Variables
+ *************************************************************************************************/
+
+static uint32_t handled_ids[MAX_NUM_HANDLED];
+static uint32_t num_handled;
+
+static uint64_t reported_lateness_ms;
+static uint32_t num_misses_reported;
+
+static enum Evf_active_object_status worker_handler(struct Evf_active_object * p_self,
+                                                    struct Evf_event const * p_event);
+
+// The priorities are the opposite of the default deadlines, and must be ignored.
+static struct Evf_active_object relaxed_worker = {
+    .name                = "Relaxed worker",
+    .priority            = 0,
+    .default_deadline_ms = 100,
+    .handle_event        = &worker_handler,
+    .event_type_subscriptions = { EVF_EVENT_TYPE_NULL },
+};
+
+static struct Evf_active_object urgent_worker = {
+    .name                = "Urgent worker",
+    .priority            = 2,
+    .default_deadline_ms = 10,
+    .handle_event        = &worker_handler,
+    .event_type_subscriptions = { EVF_EVENT_TYPE_NULL },
+};
+
+/**************************************************************************************************
+ * Static Functions
+ *************************************************************************************************/
+
+static enum Evf_active_object_status worker_handler(struct Evf_active_object * p_self,
+                                                    struct Evf_event const * p_event)
+{
+    (void)p_self;
+    struct Event_work const * p_work = (struct Event_work const *)p_event;
+    EVF_TEST_CHECK(num_handled < MAX_NUM_HANDLED);
+    handled_ids[num_handled++] = p_work->id;
+    evf_sim_busy(p_work->duration_ms);
+
+    return EVF_ACTIVE_OBJECT_STATUS_RUNNING;
+}
+
+static void record_deadline_miss(struct Evf_active_object const * p_ao,
+                                 struct Evf_event const * p_event,
+                                 uint64_t lateness_ms)
+{
+    (void)p_event;
+    EVF_TEST_CHECK(p_ao == &urgent_worker);
+    reported_lateness_ms = lateness_ms;
+    num_misses_reported++;
+}
+
+static void set_up()
+{
+    evf_sim_reset();
+    num_handled = 0;
+    reported_lateness_ms = 0;
+    num_misses_reported = 0;
+
+    evf_init();
+    evf_register_active_object(&relaxed_worker);
+    evf_register_active_object(&urgent_worker);
+    evf_register_deadline_miss_hook(&record_deadline_miss);
+}
+
+static struct Evf_event * create_work(uint32_t id, uint32_t duration_ms)
+{
+    struct Event_work * p_event = EVF_EVENT_ALLOC(struct Event_work);
+    evf_event_set_type(p_event, EVENT_TYPE_WORK);
+    p_event->id = id;
+    p_event->duration_ms = duration_ms;
+    return &p_event->base;
+}
+
+static void check_handled_ids(uint32_t const * p_expected_ids, uint32_t num_expected)
+{
+    EVF_TEST_CHECK(num_handled == num_expected);
+    for (uint32_t i = 0; i < num_expected; i++)
+    {
+        EVF_TEST_CHECK(handled_ids[i] == p_expected_ids[i]);
+    }
+}
+
+/**************************************************************************************************
+ * Tests
+ *************************************************************************************************/
+
+static void test_earliest_default_deadline_first()
+{
+    set_up();
+    EVF_TEST_CHECK(evf_post(&relaxed_worker, create_work(1, 0)));
+    EVF_TEST_CHECK(evf_post(&urgent_worker, create_work(2, 0)));
+    evf_sim_run_until_idle();
+
+    check_handled_ids((uint32_t[]){ 2, 1 }, 2);
+}
+
+static void test_explicit_deadline_overrides_default()
+{
+    set_up();
+    EVF_TEST_CHECK(evf_post(&urgent_worker, create_work(1, 0)));
+    EVF_TEST_CHECK(evf_post_with_deadline(&relaxed_worker, create_work(2, 0), 5));
+    evf_sim_run_until_idle();
+
+    check_handled_ids((uint32_t[]){ 2, 1 }, 2);
+}
+
+/* An active object handles its events in order, so the event in front of a more urgent one 
+ * inherits its deadline: both are handled before the other active object's event. The urgent event
+ * is posted last, when the relaxed worker is already scheduled by its first event's deadline.
+ */
+static void test_events_in_front_inherit_earlier_deadline()
+{
+    set_up();
+    EVF_TEST_CHECK(evf_post_with_deadline(&relaxed_worker, create_work(1, 0), 50));
+    EVF_TEST_CHECK(evf_post_with_deadline(&urgent_worker, create_work(3, 0), 20));
+    EVF_TEST_CHECK(evf_post_with_deadline(&relaxed_worker, create_work(2, 0), 5));
+    evf_sim_run_until_idle();
+
+    check_handled_ids((uint32_t[]){ 1, 2, 3 }, 3);
+    EVF_TEST_CHECK(num_misses_reported == 0);
+}
+
+// Once the urgent event has been handled, the active object goes back to its remaining deadlines.
+static void test_inherited_deadline_ends_with_urgent_event()
+{
+    set_up();
+    EVF_TEST_CHECK(evf_post_with_deadline(&relaxed_worker, create_work(1, 0), 5));
+    EVF_TEST_CHECK(evf_post_with_deadline(&relaxed_worker, create_work(2, 0), 50));
+    EVF_TEST_CHECK(evf_post_with_deadline(&urgent_worker, create_work(3, 0), 20));
+    evf_sim_run_until_idle();
+
+    check_handled_ids((uint32_t[]){ 1, 3, 2 }, 3);
+}
+
+// Time passes, so an event with a later (relative) deadline can become the most urgent one.
+static void test_deadlines_are_absolute()
+{
+    set_up();
+    EVF_TEST_CHECK(evf_post(&relaxed_worker, create_work(1, 0)));
+    evf_sim_busy(95);
+    EVF_TEST_CHECK(evf_post(&urgent_worker, create_work(2, 0)));
+    evf_sim_run_until_idle();
+
+    check_handled_ids((uint32_t[]){ 1, 2 }, 2);
+}
+
+static void test_deadline_misses_are_counted_and_reported()
+{
+    set_up();
+    EVF_TEST_CHECK(evf_post(&urgent_worker, create_work(1, 10)));
+    EVF_TEST_CHECK(evf_post(&urgent_worker, create_work(2, 5)));
+    evf_sim_run_until_idle();
+
+    // The first event is handled just in time, the second one is 5 ms late.
+    EVF_TEST_CHECK(evf_get_num_deadline_misses(&urgent_worker) == 1);
+    EVF_TEST_CHECK(num_misses_reported == 1);
+    EVF_TEST_CHECK(reported_lateness_ms == 5);
+    EVF_TEST_CHECK(evf_get_num_deadline_misses(&relaxed_worker) == 0);
+}
+
+int main()
+{
+    EVF_TEST_RUN(test_earliest_default_deadline_first);
+    EVF_TEST_RUN(test_explicit_deadline_overrides_default);
+    EVF_TEST_RUN(test_events_in_front_inherit_earlier_deadline);
+    EVF_TEST_RUN(test_inherited_deadline_ends_with_urgent_event);
+    EVF_TEST_RUN(test_deadlines_are_absolute);
+    EVF_TEST_RUN(test_deadline_misses_are_counted_and_reported);
+
+    printf("PASSED\n");
+    return 0;
+}
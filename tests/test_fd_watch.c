@@ -0,0 +1,175 @@
+/**************************************************************************************************
+ * File descriptor watches (see evf_linux_fd_watch) on the Linux port, with pipes. Every test is
+ * run under an alarm, so that a readiness event that never arrives fails the test rather than
+ * hanging it.
+ *************************************************************************************************/
+
+#define _GNU_SOURCE // For pipe2.
+
+#include "../evf.h"
+#include "../port/evf_port.h"
+#include "../port/evf_port_linux.h"
+#include "evf_test.h"
+#include <fcntl.h>
+#include <sys/epoll.h>
+#include <unistd.h>
+
+#define TEST_TIMEOUT_S    10
+
+#define TIMER_ID_WAKE_UP    1
+
+/**************************************************************************************************
+ * Static Variables
+ *************************************************************************************************/
+
+static int pipe_fds[2];
+static uint32_t num_bytes_read;
+static uint32_t num_fd_ready_events;
+static uint32_t num_timer_events;
+
+static enum Evf_active_object_status reader_handler(struct Evf_active_object * p_self,
+                                                    struct Evf_event const * p_event);
+
+static struct Evf_active_object reader = {
+    .name         = "Reader",
+    .priority     = 1,
+    .handle_event = &reader_handler,
+    .event_type_subscriptions = { EVF_EVENT_TYPE_NULL },
+};
+
+// Wakes evf_linux_wait_for_work up when no readiness is expected.
+static struct Evf_timer wake_up_timer = { .p_owner = &reader, .timer_id = TIMER_ID_WAKE_UP, .time_ms = 20 };
+
+/**************************************************************************************************
+ * Static Functions
+ *************************************************************************************************/
+
+// Watches are edge-triggered, so the reader drains the pipe every time.
+static enum Evf_active_object_status reader_handler(struct Evf_active_object * p_self,
+                                                    struct Evf_event const * p_event)
+{
+    (void)p_self;
+    if (p_event->type == EVF_EVENT_TYPE_TIMER_FINISHED)
+    {
+        num_timer_events++;
+        return EVF_ACTIVE_OBJECT_STATUS_RUNNING;
+    }
+
+    EVF_TEST_CHECK(p_event->type == EVF_EVENT_TYPE_FD_READY);
+    struct Evf_event_fd_ready const * p_ready = (struct Evf_event_fd_ready const *)p_event;
+    EVF_TEST_CHECK(p_ready->fd == pipe_fds[0]);
+    EVF_TEST_CHECK((p_ready->events & EPOLLIN) != 0);
+    num_fd_ready_events++;
+
+    char buffer[64];
+    ssize_t num_bytes;
+    while ((num_bytes = read(pipe_fds[0], buffer, sizeof(buffer))) > 0)
+    {
+        num_bytes_read += (uint32_t)num_bytes;
+    }
+
+    return EVF_ACTIVE_OBJECT_STATUS_RUNNING;
+}
+
+static void set_up()
+{
+    evf_deinit();
+    num_bytes_read = 0;
+    num_fd_ready_events = 0;
+    num_timer_events = 0;
+    EVF_TEST_CHECK(pipe2(pipe_fds, O_NONBLOCK) == 0);
+
+    evf_init();
+    evf_register_active_object(&reader);
+    evf_timer_init(&wake_up_timer);
+    alarm(TEST_TIMEOUT_S);
+}
+
+static void tear_down()
+{
+    evf_linux_fd_unwatch(pipe_fds[0]);
+    close(pipe_fds[0]);
+    close(pipe_fds[1]);
+}
+
+static void write_to_pipe(uint32_t num_bytes)
+{
+    char const buffer[64] = { 0 };
+    EVF_TEST_CHECK(write(pipe_fds[1], buffer, num_bytes) == (ssize_t)num_bytes);
+}
+
+static void wait_for_work_and_handle_it()
+{
+    evf_linux_wait_for_work();
+    while (evf_check_if_work_to_do()) { evf_task(); }
+}
+
+/**************************************************************************************************
+ * Tests
+ *************************************************************************************************/
+
+static void test_readiness_is_posted_to_owner()
+{
+    set_up();
+    EVF_TEST_CHECK(evf_linux_fd_watch(&reader, pipe_fds[0], EPOLLIN));
+    EVF_TEST_CHECK(!evf_linux_fd_watch(&reader, pipe_fds[0], EPOLLIN));
+
+    write_to_pipe(10);
+    wait_for_work_and_handle_it();
+    EVF_TEST_CHECK(num_fd_ready_events == 1);
+    EVF_TEST_CHECK(num_bytes_read == 10);
+
+    // A new edge after the pipe was drained.
+    write_to_pipe(5);
+    wait_for_work_and_handle_it();
+    EVF_TEST_CHECK(num_fd_ready_events == 2);
+    EVF_TEST_CHECK(num_bytes_read == 15);
+    tear_down();
+}
+
+// After unwatching, only the wake up timer ends the wait.
+static void test_unwatched_fd_is_not_reported()
+{
+    set_up();
+    EVF_TEST_CHECK(evf_linux_fd_watch(&reader, pipe_fds[0], EPOLLIN));
+    evf_linux_fd_unwatch(pipe_fds[0]);
+
+    write_to_pipe(10);
+    evf_timer_start(&wake_up_timer);
+    while (num_timer_events == 0) { wait_for_work_and_handle_it(); }
+    EVF_TEST_CHECK(num_fd_ready_events == 0);
+    tear_down();
+}
+
+static void test_watch_limit()
+{
+    set_up();
+    int fds[EVF_LINUX_MAX_NUM_FD_WATCHES];
+    for (uint32_t i = 0; i < EVF_LINUX_MAX_NUM_FD_WATCHES; i++)
+    {
+        fds[i] = dup(pipe_fds[0]);
+        EVF_TEST_CHECK(fds[i] != -1);
+        EVF_TEST_CHECK(evf_linux_fd_watch(&reader, fds[i], EPOLLIN));
+    }
+    EVF_TEST_CHECK(!evf_linux_fd_watch(&reader, pipe_fds[0], EPOLLIN));
+
+    evf_linux_fd_unwatch(fds[0]);
+    EVF_TEST_CHECK(evf_linux_fd_watch(&reader, pipe_fds[0], EPOLLIN));
+
+    for (uint32_t i = 0; i < EVF_LINUX_MAX_NUM_FD_WATCHES; i++)
+    {
+        evf_linux_fd_unwatch(fds[i]);
+        close(fds[i]);
+    }
+    tear_down();
+}
+
+int main()
+{
+    EVF_TEST_RUN(test_readiness_is_posted_to_owner);
+    EVF_TEST_RUN(test_unwatched_fd_is_not_reported);
+    EVF_TEST_RUN(test_watch_limit);
+
+    printf("PASSED\n");
+    return 0;
+}
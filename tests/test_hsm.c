@@ -0,0 +1,266 @@
+/**************************************************************************************************
+ * The hierarchical state machine layer (see evf_hsm.h) on the simulation port: entry/exit order,
+ * transitions handled by parent states, internal transitions, dropping unhandled events, EVF-defined
+ * event types in the tables and final states.
+ *************************************************************************************************/
+
+#include "../evf.h"
+#include "../evf_hsm.h"
+#include "../port/evf_port.h"
+#include "../port/evf_port_sim.h"
+#include "evf_test.h"
+#include <string.h>
+
+#define LOG_LENGTH    256
+
+#define TIMER_ID_WORK    1
+
+enum Test_event_types
+{
+    EVENT_TYPE_START = EVF_USER_EVENT_TYPES_START,
+    EVENT_TYPE_TICK,
+    EVENT_TYPE_STOP,
+};
+
+/**************************************************************************************************
+ * Static Variables
+ *************************************************************************************************/
+
+// The actions that have been run, e.g. "+Operational +Idle" for the entries of the initial states.
+static char action_log[LOG_LENGTH];
+
+static uint32_t num_events_destroyed;
+
+static struct Evf_hsm_state const operational_state;
+static struct Evf_hsm_state const idle_state;
+static struct Evf_hsm_state const busy_state;
+static struct Evf_hsm_state const off_state;
+
+static struct Evf_hsm_active_object machine;
+
+static struct Evf_timer work_timer = { .p_owner = &machine.base, .timer_id = TIMER_ID_WORK, .time_ms = 10 };
+
+/**************************************************************************************************
+ * Static Functions
+ *************************************************************************************************/
+
+static void log_action(char const * p_action)
+{
+    if (action_log[0] != '\0') { strcat(action_log, " "); }
+    EVF_TEST_CHECK(strlen(action_log) + strlen(p_action) < LOG_LENGTH);
+    strcat(action_log, p_action);
+}
+
+#define DEFINE_ACTION(name, text)                                                             \
+    static void name(struct Evf_hsm_active_object * p_self, struct Evf_event const * p_event) \
+    {                                                                                         \
+        (void)p_self;                                                                         \
+        (void)p_event;                                                                        \
+        log_action(text);                                                                     \
+    }
+
+DEFINE_ACTION(enter_operational, "+Operational")
+DEFINE_ACTION(exit_operational, "-Operational")
+DEFINE_ACTION(enter_idle, "+Idle")
+DEFINE_ACTION(exit_idle, "-Idle")
+DEFINE_ACTION(exit_busy, "-Busy")
+DEFINE_ACTION(enter_off, "+Off")
+DEFINE_ACTION(on_tick, "tick")
+DEFINE_ACTION(on_stop, "stop")
+DEFINE_ACTION(on_work_done, "done")
+
+static void enter_busy(struct Evf_hsm_active_object * p_self, struct Evf_event const * p_event)
+{
+    (void)p_self;
+    (void)p_event;
+    log_action("+Busy");
+    evf_timer_start(&work_timer);
+}
+
+static void count_destroyed_event(struct Evf_event * p_event)
+{
+    (void)p_event;
+    num_events_destroyed++;
+}
+
+static void set_up()
+{
+    evf_sim_reset();
+    action_log[0] = '\0';
+    num_events_destroyed = 0;
+
+    evf_init();
+    evf_register_active_object(&machine.base);
+    evf_register_event_destructor(EVENT_TYPE_START, &count_destroyed_event);
+    evf_register_event_destructor(EVENT_TYPE_TICK, &count_destroyed_event);
+    evf_register_event_destructor(EVENT_TYPE_STOP, &count_destroyed_event);
+    evf_timer_init(&work_timer);
+    evf_hsm_init(&machine);
+}
+
+// Posts without handling the event.
+static void post_only(int32_t type)
+{
+    struct Evf_event * p_event = EVF_EVENT_ALLOC(struct Evf_event);
+    evf_event_set_type(p_event, type);
+    EVF_TEST_CHECK(evf_post(&machine.base, p_event));
+}
+
+static void post(int32_t type)
+{
+    post_only(type);
+    evf_sim_advance(0);
+}
+
+static void check_log(char const * p_expected)
+{
+    EVF_TEST_CHECK(strcmp(action_log, p_expected) == 0);
+    action_log[0] = '\0';
+}
+
+/**************************************************************************************************
+ * The state machine
+ *************************************************************************************************/
+
+static struct Evf_hsm_state const operational_state = {
+    .p_name          = "Operational",
+    .p_initial_child = &idle_state,
+    .on_entry        = &enter_operational,
+    .on_exit         = &exit_operational,
+    .transitions = {
+        EVF_HSM_ON(EVENT_TYPE_STOP) = EVF_HSM_TRANSITION(&off_state, &on_stop),
+    },
+};
+
+static struct Evf_hsm_state const idle_state = {
+    .p_name   = "Idle",
+    .p_parent = &operational_state,
+    .on_entry = &enter_idle,
+    .on_exit  = &exit_idle,
+    .transitions = {
+        EVF_HSM_ON(EVENT_TYPE_START) = EVF_HSM_TRANSITION(&busy_state, NULL),
+    },
+};
+
+static struct Evf_hsm_state const busy_state = {
+    .p_name   = "Busy",
+    .p_parent = &operational_state,
+    .on_entry = &enter_busy,
+    .on_exit  = &exit_busy,
+    .transitions = {
+        EVF_HSM_ON(EVENT_TYPE_TICK)               = EVF_HSM_INTERNAL(&on_tick),
+        EVF_HSM_ON(EVF_EVENT_TYPE_TIMER_FINISHED) = EVF_HSM_TRANSITION(&idle_state, &on_work_done),
+    },
+};
+
+static struct Evf_hsm_state const off_state = {
+    .p_name   = "Off",
+    .on_entry = &enter_off,
+    .is_final = true,
+};
+
+static struct Evf_hsm_active_object machine = {
+    .base = {
+        .name          = "Machine",
+        .priority      = 1,
+        .handle_event  = &evf_hsm_dispatch,
+        .accepts_event = &evf_hsm_accepts_event,
+        .event_type_subscriptions = { EVF_EVENT_TYPE_NULL },
+    },
+    .p_initial_state = &operational_state,
+};
+
+/**************************************************************************************************
+ * Tests
+ *************************************************************************************************/
+
+// The initial state's initial child is entered too, from the outside in.
+static void test_init_enters_initial_states()
+{
+    set_up();
+    check_log("+Operational +Idle");
+    EVF_TEST_CHECK(machine.p_current_state == &idle_state);
+}
+
+// Exits run before the transition's action, entries after it, and the common parent is not left.
+static void test_transition_between_siblings()
+{
+    set_up();
+    action_log[0] = '\0';
+    post(EVENT_TYPE_START);
+    check_log("-Idle +Busy");
+    EVF_TEST_CHECK(machine.p_current_state == &busy_state);
+
+    // An EVF-defined event type in the table: the work timer finishing.
+    evf_sim_advance(10);
+    check_log("-Busy done +Idle");
+    EVF_TEST_CHECK(machine.p_current_state == &idle_state);
+}
+
+static void test_internal_transition_does_not_exit()
+{
+    set_up();
+    post(EVENT_TYPE_START);
+    action_log[0] = '\0';
+    post(EVENT_TYPE_TICK);
+    check_log("tick");
+    EVF_TEST_CHECK(machine.p_current_state == &busy_state);
+}
+
+// Idle doesn't handle ticks, and neither does its parent, so a tick is dropped instead of queued.
+static void test_unhandled_event_is_not_queued()
+{
+    set_up();
+    action_log[0] = '\0';
+    EVF_TEST_CHECK(!evf_hsm_check_if_event_type_is_handled(&machine, EVENT_TYPE_TICK));
+    post_only(EVENT_TYPE_TICK);
+    EVF_TEST_CHECK(!evf_check_if_work_to_do());
+    EVF_TEST_CHECK(num_events_destroyed == 1);
+    check_log("");
+    EVF_TEST_CHECK(machine.p_current_state == &idle_state);
+}
+
+/* Both starts are queued while Idle (which handles them) is the current state, but Busy doesn't 
+ * handle the second one, so it is dropped when it is taken. evf_hsm_dispatch asserts that it is 
+ * never given an event that is not handled.
+ */
+static void test_event_unhandled_when_taken_is_dropped()
+{
+    set_up();
+    action_log[0] = '\0';
+    post_only(EVENT_TYPE_START);
+    post_only(EVENT_TYPE_START);
+    evf_sim_advance(0);
+    check_log("-Idle +Busy");
+    EVF_TEST_CHECK(num_events_destroyed == 2);
+    EVF_TEST_CHECK(!evf_check_if_work_to_do());
+    evf_timer_stop(&work_timer);
+}
+
+// Stop is handled by the parent of the current state, which is left for the final state.
+static void test_parent_handles_event()
+{
+    set_up();
+    post(EVENT_TYPE_START);
+    action_log[0] = '\0';
+    EVF_TEST_CHECK(evf_hsm_check_if_event_type_is_handled(&machine, EVENT_TYPE_STOP));
+
+    struct Evf_event stop_event = { .type = EVENT_TYPE_STOP };
+    EVF_TEST_CHECK(evf_hsm_dispatch(&machine.base, &stop_event) == EVF_ACTIVE_OBJECT_STATUS_SHUTDOWN);
+    check_log("-Busy -Operational stop +Off");
+    EVF_TEST_CHECK(machine.p_current_state == &off_state);
+    evf_timer_stop(&work_timer);
+}
+
+int main()
+{
+    EVF_TEST_RUN(test_init_enters_initial_states);
+    EVF_TEST_RUN(test_transition_between_siblings);
+    EVF_TEST_RUN(test_internal_transition_does_not_exit);
+    EVF_TEST_RUN(test_unhandled_event_is_not_queued);
+    EVF_TEST_RUN(test_event_unhandled_when_taken_is_dropped);
+    EVF_TEST_RUN(test_parent_handles_event);
+
+    printf("PASSED\n");
+    return 0;
+}
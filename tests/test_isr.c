@@ -0,0 +1,167 @@
+/**************************************************************************************************
+ * Publishing from ISRs and signal handlers (see evf_publish_from_isr) on the simulation port: the
+ * publishes are deferred until evf_task, keep their order, and the deferral ring has a fixed size.
+ *************************************************************************************************/
+
+#include "../evf.h"
+#include "../port/evf_port.h"
+#include "../port/evf_port_sim.h"
+#include "evf_test.h"
+#include <signal.h>
+
+#define NUM_SAMPLES    (EVF_ISR_DEFERRAL_RING_LENGTH + 1)
+
+enum Test_event_types
+{
+    EVENT_TYPE_SAMPLE = EVF_USER_EVENT_TYPES_START,
+};
+
+struct Event_sample
+{
+    struct Evf_event base;
+    uint32_t index;
+};
+
+/**************************************************************************************************
+ * Static Variables
+ *************************************************************************************************/
+
+static struct Event_sample samples[NUM_SAMPLES];
+
+// The sample indexes in the order each subscriber handled them.
+static uint32_t handled_by_logger[NUM_SAMPLES];
+static uint32_t num_handled_by_logger;
+static uint32_t num_handled_by_filter;
+
+static enum Evf_active_object_status logger_handler(struct Evf_active_object * p_self,
+                                                    struct Evf_event const * p_event);
+static enum Evf_active_object_status filter_handler(struct Evf_active_object * p_self,
+                                                    struct Evf_event const * p_event);
+
+static struct Evf_active_object logger = {
+    .name         = "Logger",
+    .priority     = 1,
+    .handle_event = &logger_handler,
+    .event_type_subscriptions = { EVENT_TYPE_SAMPLE, EVF_EVENT_TYPE_NULL },
+};
+
+static struct Evf_active_object filter = {
+    .name         = "Filter",
+    .priority     = 2,
+    .handle_event = &filter_handler,
+    .event_type_subscriptions = { EVENT_TYPE_SAMPLE, EVF_EVENT_TYPE_NULL },
+};
+
+/**************************************************************************************************
+ * Static Functions
+ *************************************************************************************************/
+
+static enum Evf_active_object_status logger_handler(struct Evf_active_object * p_self,
+                                                    struct Evf_event const * p_event)
+{
+    (void)p_self;
+    EVF_TEST_CHECK(num_handled_by_logger < NUM_SAMPLES);
+    handled_by_logger[num_handled_by_logger++] = ((struct Event_sample const *)p_event)->index;
+    return EVF_ACTIVE_OBJECT_STATUS_RUNNING;
+}
+
+static enum Evf_active_object_status filter_handler(struct Evf_active_object * p_self,
+                                                    struct Evf_event const * p_event)
+{
+    (void)p_self;
+    (void)p_event;
+    num_handled_by_filter++;
+    return EVF_ACTIVE_OBJECT_STATUS_RUNNING;
+}
+
+static void sample_signal_handler(int signal_number)
+{
+    (void)signal_number;
+    evf_publish_from_isr(&samples[0].base);
+}
+
+static void set_up()
+{
+    evf_sim_reset();
+    num_handled_by_logger = 0;
+    num_handled_by_filter = 0;
+    for (uint32_t i = 0; i < NUM_SAMPLES; i++)
+    {
+        evf_event_init_static(&samples[i], EVENT_TYPE_SAMPLE);
+        samples[i].index = i;
+    }
+
+    evf_init();
+    evf_register_active_object(&logger);
+    evf_register_active_object(&filter);
+}
+
+/**************************************************************************************************
+ * Tests
+ *************************************************************************************************/
+
+// Nothing is published until evf_task runs, and the event is in use until every subscriber is done.
+static void test_publish_is_deferred_to_evf_task()
+{
+    set_up();
+    EVF_TEST_CHECK(!evf_check_if_work_to_do());
+    EVF_TEST_CHECK(evf_publish_from_isr(&samples[0].base));
+    EVF_TEST_CHECK(evf_event_check_is_in_use(&samples[0]));
+    EVF_TEST_CHECK(num_handled_by_logger == 0);
+    EVF_TEST_CHECK(evf_check_if_work_to_do());
+
+    evf_sim_run_until_idle();
+    EVF_TEST_CHECK(num_handled_by_logger == 1);
+    EVF_TEST_CHECK(num_handled_by_filter == 1);
+    EVF_TEST_CHECK(!evf_event_check_is_in_use(&samples[0]));
+
+    // A static event can be published again once it is no longer in use.
+    EVF_TEST_CHECK(evf_publish_from_isr(&samples[0].base));
+    evf_sim_run_until_idle();
+    EVF_TEST_CHECK(num_handled_by_logger == 2);
+}
+
+// A full ring refuses the publish, and the deferred publishes are delivered in order.
+static void test_ring_full()
+{
+    set_up();
+    for (uint32_t i = 0; i < EVF_ISR_DEFERRAL_RING_LENGTH; i++)
+    {
+        EVF_TEST_CHECK(evf_publish_from_isr(&samples[i].base));
+    }
+    EVF_TEST_CHECK(!evf_publish_from_isr(&samples[NUM_SAMPLES - 1].base));
+    EVF_TEST_CHECK(!evf_event_check_is_in_use(&samples[NUM_SAMPLES - 1]));
+
+    evf_sim_run_until_idle();
+    EVF_TEST_CHECK(num_handled_by_logger == EVF_ISR_DEFERRAL_RING_LENGTH);
+    for (uint32_t i = 0; i < EVF_ISR_DEFERRAL_RING_LENGTH; i++)
+    {
+        EVF_TEST_CHECK(handled_by_logger[i] == i);
+    }
+
+    EVF_TEST_CHECK(evf_publish_from_isr(&samples[NUM_SAMPLES - 1].base));
+    evf_sim_run_until_idle();
+    EVF_TEST_CHECK(handled_by_logger[EVF_ISR_DEFERRAL_RING_LENGTH] == NUM_SAMPLES - 1);
+}
+
+static void test_publish_from_signal_handler()
+{
+    set_up();
+    signal(SIGUSR1, &sample_signal_handler);
+    EVF_TEST_CHECK(raise(SIGUSR1) == 0);
+    signal(SIGUSR1, SIG_DFL);
+
+    evf_sim_run_until_idle();
+    EVF_TEST_CHECK(num_handled_by_logger == 1);
+    EVF_TEST_CHECK(handled_by_logger[0] == 0);
+}
+
+int main()
+{
+    EVF_TEST_RUN(test_publish_is_deferred_to_evf_task);
+    EVF_TEST_RUN(test_ring_full);
+    EVF_TEST_RUN(test_publish_from_signal_handler);
+
+    printf("PASSED\n");
+    return 0;
+}
@@ -0,0 +1,157 @@
+/**************************************************************************************************
+ * The offload worker pool (see port/evf_offload_linux.h) on the Linux port. Every test is run
+ * under an alarm, so that a deadlock fails the test rather than hanging it.
+ *************************************************************************************************/
+
+#include "../evf.h"
+#include "../port/evf_port.h"
+#include "../port/evf_port_linux.h"
+#include "../port/evf_offload_linux.h"
+#include "evf_test.h"
+#include <stdatomic.h>
+#include <unistd.h>
+
+#define NUM_JOBS    2000
+
+#define TEST_TIMEOUT_S    20
+
+/**************************************************************************************************
+ * Static Variables
+ *************************************************************************************************/
+
+static uint32_t job_contexts[NUM_JOBS];
+static atomic_uint num_jobs_run;
+static uint32_t num_jobs_done;
+static uint32_t num_jobs_submitted;
+static bool is_resubmitting;
+
+static enum Evf_active_object_status owner_handler(struct Evf_active_object * p_self,
+                                                   struct Evf_event const * p_event);
+
+static struct Evf_active_object owner = {
+    .name         = "Owner",
+    .priority     = 1,
+    .handle_event = &owner_handler,
+    .event_type_subscriptions = { EVF_EVENT_TYPE_NULL },
+};
+
+/**************************************************************************************************
+ * Static Functions
+ *************************************************************************************************/
+
+static void increment_job(void * p_context)
+{
+    (*(uint32_t *)p_context)++;
+    atomic_fetch_add(&num_jobs_run, 1);
+}
+
+static void submit_jobs(uint32_t num_jobs)
+{
+    while ((num_jobs_submitted < num_jobs) && evf_offload(&owner, &increment_job, &job_contexts[num_jobs_submitted]))
+    {
+        num_jobs_submitted++;
+    }
+}
+
+static enum Evf_active_object_status owner_handler(struct Evf_active_object * p_self,
+                                                   struct Evf_event const * p_event)
+{
+    (void)p_self;
+    EVF_TEST_CHECK(p_event->type == EVF_EVENT_TYPE_OFFLOAD_DONE);
+
+    struct Evf_event_offload_done const * p_done = (void const *)p_event;
+    EVF_TEST_CHECK(p_done->job == &increment_job);
+    EVF_TEST_CHECK(*(uint32_t *)p_done->p_context == 1);
+    num_jobs_done++;
+
+    if (is_resubmitting) { submit_jobs(NUM_JOBS); }
+
+    return EVF_ACTIVE_OBJECT_STATUS_RUNNING;
+}
+
+static void set_up()
+{
+    evf_deinit();
+    for (uint32_t i = 0; i < NUM_JOBS; i++) { job_contexts[i] = 0; }
+    atomic_store(&num_jobs_run, 0);
+    num_jobs_done = 0;
+    num_jobs_submitted = 0;
+    is_resubmitting = false;
+
+    evf_init();
+    evf_register_active_object(&owner);
+    alarm(TEST_TIMEOUT_S);
+}
+
+static void handle_all_pending_events()
+{
+    while (evf_check_if_work_to_do()) { evf_task(); }
+}
+
+/**************************************************************************************************
+ * Tests
+ *************************************************************************************************/
+
+// Every job runs exactly once and its completion is posted back to its owner.
+static void test_every_job_completes_once()
+{
+    set_up();
+    EVF_TEST_CHECK(!evf_offload(&owner, &increment_job, &job_contexts[0]));
+    EVF_TEST_CHECK(evf_offload_start(4));
+    EVF_TEST_CHECK(!evf_offload_start(2));
+
+    is_resubmitting = true;
+    submit_jobs(NUM_JOBS);
+    EVF_TEST_CHECK(num_jobs_submitted == EVF_OFFLOAD_MAX_NUM_JOBS);
+    while (num_jobs_done < NUM_JOBS)
+    {
+        evf_linux_wait_for_work();
+        evf_task();
+    }
+    evf_offload_stop();
+
+    EVF_TEST_CHECK(atomic_load(&num_jobs_run) == NUM_JOBS);
+    for (uint32_t i = 0; i < NUM_JOBS; i++) { EVF_TEST_CHECK(job_contexts[i] == 1); }
+}
+
+/* More jobs complete than the owner's queue can hold, and the pool is stopped (from the evf_task
+ * thread) while the rest of the completions are pending. Stopping must not wait for them, and they
+ * are posted once the pool has been started again.
+ */
+static void test_stop_with_full_owner_queue()
+{
+    set_up();
+    uint32_t const num_jobs = EVF_EVENT_QUEUE_LENGTH * 2;
+    EVF_TEST_CHECK(evf_offload_start(2));
+    submit_jobs(num_jobs);
+    EVF_TEST_CHECK(num_jobs_submitted == num_jobs);
+    while (atomic_load(&num_jobs_run) < num_jobs) { usleep(1000); }
+
+    // No events are handled, so the owner's queue fills up.
+    usleep(10000);
+    evf_offload_stop();
+    EVF_TEST_CHECK(!evf_offload(&owner, &increment_job, &job_contexts[num_jobs]));
+
+    handle_all_pending_events();
+    EVF_TEST_CHECK(num_jobs_done == EVF_EVENT_QUEUE_LENGTH);
+
+    EVF_TEST_CHECK(evf_offload_start(1));
+    while (num_jobs_done < num_jobs)
+    {
+        evf_linux_wait_for_work();
+        evf_task();
+    }
+    evf_offload_stop();
+
+    EVF_TEST_CHECK(num_jobs_done == num_jobs);
+    for (uint32_t i = 0; i < num_jobs; i++) { EVF_TEST_CHECK(job_contexts[i] == 1); }
+}
+
+int main()
+{
+    EVF_TEST_RUN(test_every_job_completes_once);
+    EVF_TEST_RUN(test_stop_with_full_owner_queue);
+
+    printf("PASSED\n");
+    return 0;
+}
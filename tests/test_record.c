@@ -0,0 +1,237 @@
+/**************************************************************************************************
+ * Record/replay (see port/evf_record_linux.h) on the simulation port: a recorded run that starts a
+ * timer is replayed, and the active object must see exactly the same events at the same times.
+ *************************************************************************************************/
+
+#include "../evf.h"
+#include "../port/evf_port.h"
+#include "../port/evf_port_sim.h"
+#include "../port/evf_record_linux.h"
+#include "evf_test.h"
+#include <fcntl.h>
+#include <string.h>
+#include <unistd.h>
+
+#define MAX_NUM_HANDLED    16
+#define LOG_CAPACITY_BYTES    4096
+
+// Where the log header keeps the number of bytes used, see port/evf_record_linux.c.
+#define LOG_NUM_BYTES_USED_OFFSET    8
+
+enum Test_event_types
+{
+    EVENT_TYPE_START = EVF_USER_EVENT_TYPES_START,
+};
+
+struct Event_start
+{
+    struct Evf_event base;
+    uint32_t value;
+};
+
+struct Handled_event
+{
+    uint64_t timestamp_ms;
+    int32_t type;
+    uint32_t value; // The value of the last start event, for timer finished events.
+};
+
+/**************************************************************************************************
+ * Static Variables
+ *************************************************************************************************/
+
+static struct Handled_event handled[MAX_NUM_HANDLED];
+static uint32_t num_handled;
+static uint32_t last_start_value;
+
+static enum Evf_active_object_status sequencer_handler(struct Evf_active_object * p_self,
+                                                       struct Evf_event const * p_event);
+
+static struct Evf_active_object sequencer = {
+    .name         = "Sequencer",
+    .priority     = 1,
+    .handle_event = &sequencer_handler,
+    .event_type_subscriptions = { EVF_EVENT_TYPE_NULL },
+};
+
+static struct Evf_timer sequence_timer = { .p_owner = &sequencer, .timer_id = 1, .time_ms = 20 };
+
+/**************************************************************************************************
+ * Static Functions
+ *************************************************************************************************/
+
+// Every start event (re)starts the timer.
+static enum Evf_active_object_status sequencer_handler(struct Evf_active_object * p_self,
+                                                       struct Evf_event const * p_event)
+{
+    (void)p_self;
+    if (p_event->type == EVENT_TYPE_START)
+    {
+        last_start_value = ((struct Event_start const *)p_event)->value;
+        evf_timer_start(&sequence_timer);
+    }
+
+    EVF_TEST_CHECK(num_handled < MAX_NUM_HANDLED);
+    handled[num_handled++] = (struct Handled_event){
+        .timestamp_ms = evf_get_timestamp_ms(),
+        .type         = p_event->type,
+        .value        = last_start_value,
+    };
+
+    return EVF_ACTIVE_OBJECT_STATUS_RUNNING;
+}
+
+static uint32_t serialize_start(struct Evf_event const * p_event, void * p_buffer, uint32_t buffer_size)
+{
+    uint32_t value = ((struct Event_start const *)p_event)->value;
+    if (buffer_size >= sizeof(value)) { memcpy(p_buffer, &value, sizeof(value)); }
+    return sizeof(value);
+}
+
+static struct Evf_event * deserialize_start(void const * p_buffer, uint32_t num_bytes)
+{
+    EVF_TEST_CHECK(num_bytes == sizeof(uint32_t));
+    struct Event_start * p_event = EVF_EVENT_ALLOC(struct Event_start);
+    evf_event_set_type(p_event, EVENT_TYPE_START);
+    memcpy(&p_event->value, p_buffer, sizeof(p_event->value));
+    return &p_event->base;
+}
+
+static void set_up()
+{
+    evf_sim_reset();
+    num_handled = 0;
+    last_start_value = 0;
+
+    evf_init();
+    evf_register_active_object(&sequencer);
+    evf_record_register_serializer(EVENT_TYPE_START, &serialize_start, &deserialize_start);
+    evf_timer_init(&sequence_timer);
+}
+
+static void post_start(uint32_t value)
+{
+    struct Event_start * p_event = EVF_EVENT_ALLOC(struct Event_start);
+    evf_event_set_type(p_event, EVENT_TYPE_START);
+    p_event->value = value;
+    EVF_TEST_CHECK(evf_post(&sequencer, &p_event->base));
+}
+
+static void create_log_path(char * p_path)
+{
+    int fd = mkstemp(p_path);
+    EVF_TEST_CHECK(fd != -1);
+    close(fd);
+}
+
+// Cuts num_bytes off the end of the log, as if the recording had stopped part way through a record.
+static void truncate_log(char const * p_path, uint64_t num_bytes)
+{
+    int fd = open(p_path, O_RDWR);
+    EVF_TEST_CHECK(fd != -1);
+
+    uint64_t num_bytes_used;
+    EVF_TEST_CHECK(pread(fd, &num_bytes_used, sizeof(num_bytes_used), LOG_NUM_BYTES_USED_OFFSET)
+        == sizeof(num_bytes_used));
+    num_bytes_used -= num_bytes;
+    EVF_TEST_CHECK(pwrite(fd, &num_bytes_used, sizeof(num_bytes_used), LOG_NUM_BYTES_USED_OFFSET)
+        == sizeof(num_bytes_used));
+    EVF_TEST_CHECK(ftruncate(fd, (off_t)num_bytes_used) == 0);
+    close(fd);
+}
+
+/**************************************************************************************************
+ * Tests
+ *************************************************************************************************/
+
+static void test_replay_with_timer_matches_recording()
+{
+    char log_path[] = "/tmp/evf_test_record_XXXXXX";
+    create_log_path(log_path);
+
+    set_up();
+    EVF_TEST_CHECK(evf_record_start(log_path, LOG_CAPACITY_BYTES));
+    post_start(7);
+    evf_sim_advance(5);
+    post_start(9);
+    evf_sim_run_until_idle();
+    evf_record_stop();
+
+    // The timer finished event is not recorded, so nothing is dropped.
+    EVF_TEST_CHECK(evf_record_get_num_dropped() == 0);
+    EVF_TEST_CHECK(num_handled == 3);
+    struct Handled_event recorded[3];
+    memcpy(recorded, handled, sizeof(recorded));
+    EVF_TEST_CHECK((recorded[0].timestamp_ms == 0) && (recorded[0].type == EVENT_TYPE_START));
+    EVF_TEST_CHECK((recorded[1].timestamp_ms == 5) && (recorded[1].type == EVENT_TYPE_START));
+    EVF_TEST_CHECK((recorded[2].timestamp_ms == 25) && (recorded[2].type == EVF_EVENT_TYPE_TIMER_FINISHED));
+    EVF_TEST_CHECK(recorded[2].value == 9);
+
+    set_up();
+    EVF_TEST_CHECK(evf_replay_open(log_path, EVF_REPLAY_MODE_REAL_TIME));
+    while (evf_replay_step())
+    {
+        evf_sim_advance(1);
+    }
+    evf_sim_run_until_idle();
+    evf_replay_close();
+    unlink(log_path);
+
+    // Exactly the recorded events: the timer finished once, driven by the live timer.
+    EVF_TEST_CHECK(evf_replay_get_num_dropped() == 0);
+    EVF_TEST_CHECK(num_handled == 3);
+    for (uint32_t i = 0; i < 3; i++)
+    {
+        EVF_TEST_CHECK(handled[i].timestamp_ms == recorded[i].timestamp_ms);
+        EVF_TEST_CHECK(handled[i].type == recorded[i].type);
+        EVF_TEST_CHECK(handled[i].value == recorded[i].value);
+    }
+}
+
+/* The second of two records is cut short, once within its payload and once within its header. 
+ * The first record is still replayed, then replaying stops with an error rather than reading past
+ * the end of the log.
+ */
+static void test_replay_of_truncated_log_fails()
+{
+    uint64_t const num_bytes_to_cut[] = { 6, 20 };
+    for (uint32_t i = 0; i < 2; i++)
+    {
+        char log_path[] = "/tmp/evf_test_record_XXXXXX";
+        create_log_path(log_path);
+
+        set_up();
+        EVF_TEST_CHECK(evf_record_start(log_path, LOG_CAPACITY_BYTES));
+        post_start(7);
+        post_start(9);
+        evf_sim_run_until_idle();
+        evf_record_stop();
+        truncate_log(log_path, num_bytes_to_cut[i]);
+
+        set_up();
+        EVF_TEST_CHECK(evf_replay_open(log_path, EVF_REPLAY_MODE_AS_FAST_AS_POSSIBLE));
+        EVF_TEST_CHECK(!evf_replay_check_has_failed());
+        while (evf_replay_step())
+        {
+            while (evf_check_if_work_to_do()) { evf_task(); }
+        }
+        while (evf_check_if_work_to_do()) { evf_task(); }
+        EVF_TEST_CHECK(evf_replay_check_has_failed());
+        EVF_TEST_CHECK(!evf_replay_step());
+        evf_replay_close();
+        unlink(log_path);
+
+        EVF_TEST_CHECK(num_handled == 1);
+        EVF_TEST_CHECK((handled[0].type == EVENT_TYPE_START) && (handled[0].value == 7));
+        evf_timer_stop(&sequence_timer);
+    }
+}
+
+int main()
+{
+    EVF_TEST_RUN(test_replay_with_timer_matches_recording);
+    EVF_TEST_RUN(test_replay_of_truncated_log_fails);
+
+    printf("PASSED\n");
+    return 0;
+}
@@ -0,0 +1,209 @@
+/**************************************************************************************************
+ * Request/reply (see evf_request and evf_reply) on the simulation port: replies only go to the
+ * requester, timeouts, late replies and the limit on pending requests.
+ *************************************************************************************************/
+
+#include "../evf.h"
+#include "../port/evf_port.h"
+#include "../port/evf_port_sim.h"
+#include "evf_test.h"
+
+#define MAX_NUM_RECEIVED    16
+
+#define REQUEST_TIMEOUT_MS    50
+
+enum Test_event_types
+{
+    EVENT_TYPE_QUERY = EVF_USER_EVENT_TYPES_START,
+    EVENT_TYPE_ANSWER,
+};
+
+struct Received_event
+{
+    uint64_t timestamp_ms;
+    int32_t type;
+    uint32_t correlation_id;
+};
+
+/**************************************************************************************************
+ * Static Variables
+ *************************************************************************************************/
+
+static struct Received_event received[MAX_NUM_RECEIVED];
+static uint32_t num_received;
+static uint32_t num_received_by_bystander;
+
+// When set, the server keeps a copy of the last query instead of answering it.
+static bool is_server_slow;
+static struct Evf_event slow_query;
+
+static enum Evf_active_object_status server_handler(struct Evf_active_object * p_self,
+                                                    struct Evf_event const * p_event);
+static enum Evf_active_object_status client_handler(struct Evf_active_object * p_self,
+                                                    struct Evf_event const * p_event);
+static enum Evf_active_object_status bystander_handler(struct Evf_active_object * p_self,
+                                                       struct Evf_event const * p_event);
+
+static struct Evf_active_object server = {
+    .name         = "Server",
+    .priority     = 1,
+    .handle_event = &server_handler,
+    .event_type_subscriptions = { EVF_EVENT_TYPE_NULL },
+};
+
+static struct Evf_active_object client = {
+    .name         = "Client",
+    .priority     = 2,
+    .handle_event = &client_handler,
+    .event_type_subscriptions = { EVF_EVENT_TYPE_NULL },
+};
+
+// Subscribes to answers, but must never see the ones meant for the client.
+static struct Evf_active_object bystander = {
+    .name         = "Bystander",
+    .priority     = 2,
+    .handle_event = &bystander_handler,
+    .event_type_subscriptions = { EVENT_TYPE_ANSWER, EVF_EVENT_TYPE_NULL },
+};
+
+/**************************************************************************************************
+ * Static Functions
+ *************************************************************************************************/
+
+static struct Evf_event * create_event(int32_t type)
+{
+    struct Evf_event * p_event = EVF_EVENT_ALLOC(struct Evf_event);
+    evf_event_set_type(p_event, type);
+    return p_event;
+}
+
+static enum Evf_active_object_status server_handler(struct Evf_active_object * p_self,
+                                                    struct Evf_event const * p_event)
+{
+    (void)p_self;
+    EVF_TEST_CHECK(p_event->type == EVENT_TYPE_QUERY);
+    if (is_server_slow)
+    {
+        slow_query = *p_event;
+    }
+    else
+    {
+        EVF_TEST_CHECK(evf_reply(p_event, create_event(EVENT_TYPE_ANSWER)));
+    }
+
+    return EVF_ACTIVE_OBJECT_STATUS_RUNNING;
+}
+
+static enum Evf_active_object_status client_handler(struct Evf_active_object * p_self,
+                                                    struct Evf_event const * p_event)
+{
+    (void)p_self;
+    EVF_TEST_CHECK(num_received < MAX_NUM_RECEIVED);
+    received[num_received++] = (struct Received_event){
+        .timestamp_ms   = evf_get_timestamp_ms(),
+        .type           = p_event->type,
+        .correlation_id = p_event->correlation_id,
+    };
+
+    return EVF_ACTIVE_OBJECT_STATUS_RUNNING;
+}
+
+static enum Evf_active_object_status bystander_handler(struct Evf_active_object * p_self,
+                                                       struct Evf_event const * p_event)
+{
+    (void)p_self;
+    (void)p_event;
+    num_received_by_bystander++;
+    return EVF_ACTIVE_OBJECT_STATUS_RUNNING;
+}
+
+static void set_up()
+{
+    evf_sim_reset();
+    num_received = 0;
+    num_received_by_bystander = 0;
+    is_server_slow = false;
+
+    evf_init();
+    evf_register_active_object(&server);
+    evf_register_active_object(&client);
+    evf_register_active_object(&bystander);
+}
+
+static void check_received(uint32_t index, uint64_t timestamp_ms, int32_t type, uint32_t correlation_id)
+{
+    EVF_TEST_CHECK(index < num_received);
+    EVF_TEST_CHECK(received[index].timestamp_ms == timestamp_ms);
+    EVF_TEST_CHECK(received[index].type == type);
+    EVF_TEST_CHECK(received[index].correlation_id == correlation_id);
+}
+
+/**************************************************************************************************
+ * Tests
+ *************************************************************************************************/
+
+// The answer goes to the client only, with the request's correlation ID, and cancels the timeout.
+static void test_reply_goes_to_requester()
+{
+    set_up();
+    uint32_t first_id = evf_request(&server, create_event(EVENT_TYPE_QUERY), &client, REQUEST_TIMEOUT_MS);
+    uint32_t second_id = evf_request(&server, create_event(EVENT_TYPE_QUERY), &client, 0);
+    EVF_TEST_CHECK((first_id != 0) && (second_id != 0) && (first_id != second_id));
+
+    evf_sim_advance(REQUEST_TIMEOUT_MS * 2);
+    EVF_TEST_CHECK(num_received == 2);
+    check_received(0, 0, EVENT_TYPE_ANSWER, first_id);
+    check_received(1, 0, EVENT_TYPE_ANSWER, second_id);
+    EVF_TEST_CHECK(num_received_by_bystander == 0);
+}
+
+// Without an answer in time, the client gets a timeout instead, and the late answer is refused.
+static void test_request_times_out()
+{
+    set_up();
+    is_server_slow = true;
+    uint32_t id = evf_request(&server, create_event(EVENT_TYPE_QUERY), &client, REQUEST_TIMEOUT_MS);
+    EVF_TEST_CHECK(id != 0);
+
+    evf_sim_advance(REQUEST_TIMEOUT_MS - 1);
+    EVF_TEST_CHECK(num_received == 0);
+    evf_sim_advance(1);
+    EVF_TEST_CHECK(num_received == 1);
+    check_received(0, REQUEST_TIMEOUT_MS, EVF_EVENT_TYPE_REQUEST_TIMEOUT, id);
+
+    struct Evf_event * p_late_answer = create_event(EVENT_TYPE_ANSWER);
+    EVF_TEST_CHECK(!evf_reply(&slow_query, p_late_answer));
+    evf_free(p_late_answer);
+    evf_sim_run_until_idle();
+    EVF_TEST_CHECK(num_received == 1);
+}
+
+// Only requests with a timeout take up one of the pending request slots, until they are done.
+static void test_pending_request_limit()
+{
+    set_up();
+    is_server_slow = true;
+    for (uint32_t i = 0; i < EVF_MAX_NUM_PENDING_REQUESTS; i++)
+    {
+        EVF_TEST_CHECK(evf_request(&server, create_event(EVENT_TYPE_QUERY), &client, REQUEST_TIMEOUT_MS) != 0);
+    }
+
+    struct Evf_event * p_query = create_event(EVENT_TYPE_QUERY);
+    EVF_TEST_CHECK(evf_request(&server, p_query, &client, REQUEST_TIMEOUT_MS) == 0);
+    EVF_TEST_CHECK(evf_request(&server, p_query, &client, 0) != 0);
+
+    evf_sim_advance(REQUEST_TIMEOUT_MS);
+    EVF_TEST_CHECK(num_received == EVF_MAX_NUM_PENDING_REQUESTS);
+    EVF_TEST_CHECK(evf_request(&server, create_event(EVENT_TYPE_QUERY), &client, REQUEST_TIMEOUT_MS) != 0);
+    evf_sim_run_until_idle();
+}
+
+int main()
+{
+    EVF_TEST_RUN(test_reply_goes_to_requester);
+    EVF_TEST_RUN(test_request_times_out);
+    EVF_TEST_RUN(test_pending_request_limit);
+
+    printf("PASSED\n");
+    return 0;
+}
@@ -0,0 +1,149 @@
+/**************************************************************************************************
+ * Run-to-completion step budgets and the watchdog view of the step in progress (see
+ * evf_get_current_rtc_step), on the simulation port. Each event says how long its step takes.
+ *************************************************************************************************/
+
+#include "../evf.h"
+#include "../port/evf_port.h"
+#include "../port/evf_port_sim.h"
+#include "evf_test.h"
+
+#define RTC_BUDGET_US    2000
+
+enum Test_event_types
+{
+    EVENT_TYPE_WORK = EVF_USER_EVENT_TYPES_START,
+};
+
+struct Event_work
+{
+    struct Evf_event base;
+    uint32_t duration_ms;
+};
+
+/**************************************************************************************************
+ * Static Variables
+ *************************************************************************************************/
+
+static enum Evf_active_object_status worker_handler(struct Evf_active_object * p_self,
+                                                    struct Evf_event const * p_event);
+
+static struct Evf_active_object worker = {
+    .name          = "Worker",
+    .priority      = 1,
+    .handle_event  = &worker_handler,
+    .rtc_budget_us = RTC_BUDGET_US,
+    .event_type_subscriptions = { EVF_EVENT_TYPE_NULL },
+};
+
+// What the watchdog saw at the start of each step.
+static struct Evf_rtc_step_info observed_steps[4];
+static uint32_t num_observed_steps;
+
+static uint64_t overrun_durations_us[4];
+static uint32_t num_overruns_reported;
+
+/**************************************************************************************************
+ * Static Functions
+ *************************************************************************************************/
+
+static enum Evf_active_object_status worker_handler(struct Evf_active_object * p_self,
+                                                    struct Evf_event const * p_event)
+{
+    (void)p_self;
+    EVF_TEST_CHECK(num_observed_steps < 4);
+    EVF_TEST_CHECK(evf_get_current_rtc_step(&observed_steps[num_observed_steps]));
+    num_observed_steps++;
+
+    evf_sim_busy(((struct Event_work const *)p_event)->duration_ms);
+    return EVF_ACTIVE_OBJECT_STATUS_RUNNING;
+}
+
+static void record_overrun(struct Evf_active_object const * p_ao,
+                           struct Evf_event const * p_event,
+                           uint64_t duration_us)
+{
+    EVF_TEST_CHECK(p_ao == &worker);
+    EVF_TEST_CHECK(p_event->type == EVENT_TYPE_WORK);
+    EVF_TEST_CHECK(num_overruns_reported < 4);
+    overrun_durations_us[num_overruns_reported++] = duration_us;
+}
+
+static void set_up()
+{
+    evf_sim_reset();
+    num_observed_steps = 0;
+    num_overruns_reported = 0;
+
+    evf_init();
+    evf_register_active_object(&worker);
+    evf_register_rtc_budget_overrun_hook(&record_overrun);
+}
+
+static void post_work(uint32_t duration_ms)
+{
+    struct Event_work * p_event = EVF_EVENT_ALLOC(struct Event_work);
+    evf_event_set_type(p_event, EVENT_TYPE_WORK);
+    p_event->duration_ms = duration_ms;
+    EVF_TEST_CHECK(evf_post(&worker, &p_event->base));
+}
+
+/**************************************************************************************************
+ * Tests
+ *************************************************************************************************/
+
+// Only the steps that take longer than the budget are overruns.
+static void test_overruns_are_counted_and_reported()
+{
+    set_up();
+    post_work(1);
+    post_work(2);
+    post_work(5);
+    evf_sim_run_until_idle();
+
+    EVF_TEST_CHECK(evf_get_num_rtc_budget_overruns(&worker) == 1);
+    EVF_TEST_CHECK(num_overruns_reported == 1);
+    EVF_TEST_CHECK(overrun_durations_us[0] == 5000);
+}
+
+// The step in progress is visible while it runs, and consecutive steps can be told apart.
+static void test_current_step_is_visible()
+{
+    set_up();
+    struct Evf_rtc_step_info info;
+    EVF_TEST_CHECK(!evf_get_current_rtc_step(&info));
+
+    evf_sim_advance(7);
+    post_work(3);
+    post_work(0);
+    evf_sim_run_until_idle();
+
+    EVF_TEST_CHECK(num_observed_steps == 2);
+    EVF_TEST_CHECK(observed_steps[0].p_ao == &worker);
+    EVF_TEST_CHECK(observed_steps[0].event_type == EVENT_TYPE_WORK);
+    EVF_TEST_CHECK(observed_steps[0].start_timestamp_us == 7000);
+    EVF_TEST_CHECK(observed_steps[1].start_timestamp_us == 10000);
+    EVF_TEST_CHECK(observed_steps[1].step_number == observed_steps[0].step_number + 1);
+    EVF_TEST_CHECK(!evf_get_current_rtc_step(&info));
+}
+
+static void test_hook_can_be_deregistered()
+{
+    set_up();
+    evf_register_rtc_budget_overrun_hook(NULL);
+    post_work(10);
+    evf_sim_run_until_idle();
+
+    EVF_TEST_CHECK(evf_get_num_rtc_budget_overruns(&worker) == 1);
+    EVF_TEST_CHECK(num_overruns_reported == 0);
+}
+
+int main()
+{
+    EVF_TEST_RUN(test_overruns_are_counted_and_reported);
+    EVF_TEST_RUN(test_current_step_is_visible);
+    EVF_TEST_RUN(test_hook_can_be_deregistered);
+
+    printf("PASSED\n");
+    return 0;
+}
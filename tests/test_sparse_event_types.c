@@ -0,0 +1,150 @@
+/**************************************************************************************************
+ * Sparse user-defined event types (see EVF_SPARSE_EVENT_TYPES_ENABLED) on the simulation port:
+ * protocol ID style types are routed to their subscribers and get their destructors, and the
+ * event type index hands out dense indices until it is full. Built with a small index, so that
+ * filling it is quick.
+ *************************************************************************************************/
+
+#include "../evf.h"
+#include "../port/evf_port.h"
+#include "../port/evf_port_sim.h"
+#include "evf_test.h"
+
+// Protocol IDs that share their low bits.
+#define EVENT_TYPE_STATUS     0x00001000
+#define EVENT_TYPE_COMMAND    0x00002000
+#define EVENT_TYPE_LOG        0x10002000
+#define EVENT_TYPE_UNUSED     0x00003000
+
+/**************************************************************************************************
+ * Static Variables
+ *************************************************************************************************/
+
+static uint32_t num_handled_by_monitor;
+static uint32_t num_handled_by_controller;
+static uint32_t num_logs_destroyed;
+
+static enum Evf_active_object_status monitor_handler(struct Evf_active_object * p_self,
+                                                     struct Evf_event const * p_event);
+static enum Evf_active_object_status controller_handler(struct Evf_active_object * p_self,
+                                                        struct Evf_event const * p_event);
+
+static struct Evf_active_object monitor = {
+    .name         = "Monitor",
+    .priority     = 1,
+    .handle_event = &monitor_handler,
+    .event_type_subscriptions = { EVENT_TYPE_STATUS, EVENT_TYPE_LOG, EVF_EVENT_TYPE_NULL },
+};
+
+static struct Evf_active_object controller = {
+    .name         = "Controller",
+    .priority     = 2,
+    .handle_event = &controller_handler,
+    .event_type_subscriptions = { EVENT_TYPE_COMMAND, EVF_EVENT_TYPE_NULL },
+};
+
+/**************************************************************************************************
+ * Static Functions
+ *************************************************************************************************/
+
+static enum Evf_active_object_status monitor_handler(struct Evf_active_object * p_self,
+                                                     struct Evf_event const * p_event)
+{
+    (void)p_self;
+    EVF_TEST_CHECK((p_event->type == EVENT_TYPE_STATUS) || (p_event->type == EVENT_TYPE_LOG));
+    num_handled_by_monitor++;
+    return EVF_ACTIVE_OBJECT_STATUS_RUNNING;
+}
+
+static enum Evf_active_object_status controller_handler(struct Evf_active_object * p_self,
+                                                        struct Evf_event const * p_event)
+{
+    (void)p_self;
+    EVF_TEST_CHECK(p_event->type == EVENT_TYPE_COMMAND);
+    num_handled_by_controller++;
+    return EVF_ACTIVE_OBJECT_STATUS_RUNNING;
+}
+
+static void destroy_log(struct Evf_event * p_event)
+{
+    EVF_TEST_CHECK(p_event->type == EVENT_TYPE_LOG);
+    num_logs_destroyed++;
+}
+
+static void set_up()
+{
+    evf_sim_reset();
+    num_handled_by_monitor = 0;
+    num_handled_by_controller = 0;
+    num_logs_destroyed = 0;
+
+    evf_init();
+    evf_register_active_object(&monitor);
+    evf_register_active_object(&controller);
+    evf_register_event_destructor(EVENT_TYPE_LOG, &destroy_log);
+}
+
+static void publish(int32_t type)
+{
+    struct Evf_event * p_event = EVF_EVENT_ALLOC(struct Evf_event);
+    evf_event_set_type(p_event, type);
+    evf_publish(NULL, p_event);
+}
+
+/**************************************************************************************************
+ * Tests
+ *************************************************************************************************/
+
+static void test_events_reach_their_subscribers()
+{
+    set_up();
+    publish(EVENT_TYPE_STATUS);
+    publish(EVENT_TYPE_COMMAND);
+    publish(EVENT_TYPE_LOG);
+    publish(EVENT_TYPE_UNUSED);
+    evf_sim_run_until_idle();
+
+    EVF_TEST_CHECK(num_handled_by_monitor == 2);
+    EVF_TEST_CHECK(num_handled_by_controller == 1);
+    EVF_TEST_CHECK(num_logs_destroyed == 1);
+}
+
+// Subscribed types have distinct dense indices, and types that were never added have none.
+static void test_indices_are_dense()
+{
+    set_up();
+    int32_t const types[] = { EVENT_TYPE_STATUS, EVENT_TYPE_COMMAND, EVENT_TYPE_LOG };
+    bool is_index_used[EVF_MAX_NUM_USER_DEFINED_EVENT_TYPES] = { false };
+    for (uint32_t i = 0; i < 3; i++)
+    {
+        int32_t index = evf_get_event_type_index(types[i]);
+        EVF_TEST_CHECK((index >= 0) && (index < EVF_MAX_NUM_USER_DEFINED_EVENT_TYPES));
+        EVF_TEST_CHECK(!is_index_used[index]);
+        is_index_used[index] = true;
+    }
+    EVF_TEST_CHECK(evf_get_event_type_index(EVENT_TYPE_UNUSED) == -1);
+}
+
+static void test_index_fills_up()
+{
+    set_up();
+    EVF_TEST_CHECK(evf_register_event_type(EVENT_TYPE_STATUS) == evf_get_event_type_index(EVENT_TYPE_STATUS));
+
+    // 3 types are in use already.
+    for (int32_t i = 3; i < EVF_MAX_NUM_USER_DEFINED_EVENT_TYPES; i++)
+    {
+        EVF_TEST_CHECK(evf_register_event_type(EVENT_TYPE_UNUSED + i) == i);
+    }
+    EVF_TEST_CHECK(evf_register_event_type(EVENT_TYPE_UNUSED) == -1);
+    EVF_TEST_CHECK(evf_get_event_type_index(EVENT_TYPE_UNUSED) == -1);
+}
+
+int main()
+{
+    EVF_TEST_RUN(test_events_reach_their_subscribers);
+    EVF_TEST_RUN(test_indices_are_dense);
+    EVF_TEST_RUN(test_index_fills_up);
+
+    printf("PASSED\n");
+    return 0;
+}
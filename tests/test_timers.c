@@ -0,0 +1,287 @@
+/**************************************************************************************************
+ * Timer behaviour on the simulation port: slack/coalescing, drift-free periodic timers, the
+ * catch-up policies and evf_get_next_wakeup.
+ *************************************************************************************************/
+
+#include "../evf.h"
+#include "../port/evf_port.h"
+#include "../port/evf_port_sim.h"
+#include "evf_test.h"
+
+#define MAX_NUM_HANDLED    64
+
+enum Test_event_types
+{
+    EVENT_TYPE_TEST = EVF_USER_EVENT_TYPES_START,
+};
+
+struct Handled_timer_event
+{
+    uint64_t timestamp_ms;
+    uint32_t timer_id;
+    uint32_t num_expirations;
+};
+
+/**************************************************************************************************
+ * Static Variables
+ *************************************************************************************************/
+
+static struct Handled_timer_event handled[MAX_NUM_HANDLED];
+static uint32_t num_handled;
+
+// How long each handling of a timer finished event takes, and for how many of them.
+static uint64_t busy_ms;
+static uint32_t num_busy_handlings;
+
+static enum Evf_active_object_status timer_owner_handler(struct Evf_active_object * p_self,
+                                                         struct Evf_event const * p_event);
+
+static struct Evf_active_object timer_owner = {
+    .name         = "Timer owner",
+    .priority     = 1,
+    .handle_event = &timer_owner_handler,
+    .event_type_subscriptions = { EVF_EVENT_TYPE_NULL },
+};
+
+static struct Evf_timer slack_timer_a = { .p_owner = &timer_owner, .timer_id = 1, .time_ms = 100, .slack_ms = 10 };
+static struct Evf_timer slack_timer_b = { .p_owner = &timer_owner, .timer_id = 2, .time_ms = 105, .slack_ms = 10 };
+static struct Evf_timer exact_timer_c = { .p_owner = &timer_owner, .timer_id = 3, .time_ms = 108 };
+static struct Evf_timer exact_timer_d = { .p_owner = &timer_owner, .timer_id = 4, .time_ms = 200 };
+
+static struct Evf_timer periodic_timer = {
+    .p_owner = &timer_owner, .timer_id = 5, .time_ms = 10, .is_periodic = true,
+};
+static struct Evf_timer coalescing_timer = {
+    .p_owner = &timer_owner, .timer_id = 6, .time_ms = 10, .is_periodic = true,
+    .catch_up_policy = EVF_TIMER_CATCH_UP_POLICY_COALESCE,
+};
+static struct Evf_timer fire_all_timer = {
+    .p_owner = &timer_owner, .timer_id = 7, .time_ms = 10, .is_periodic = true,
+    .catch_up_policy = EVF_TIMER_CATCH_UP_POLICY_FIRE_ALL,
+};
+static struct Evf_timer skipping_timer = {
+    .p_owner = &timer_owner, .timer_id = 8, .time_ms = 10, .is_periodic = true,
+    .catch_up_policy = EVF_TIMER_CATCH_UP_POLICY_SKIP,
+};
+
+/**************************************************************************************************
+ * Static Functions
+ *************************************************************************************************/
+
+static enum Evf_active_object_status timer_owner_handler(struct Evf_active_object * p_self,
+                                                         struct Evf_event const * p_event)
+{
+    (void)p_self;
+    if (p_event->type != EVF_EVENT_TYPE_TIMER_FINISHED) { return EVF_ACTIVE_OBJECT_STATUS_RUNNING; }
+
+    struct Evf_event_timer_finished const * p_timer_event = (void const *)p_event;
+    EVF_TEST_CHECK(num_handled < MAX_NUM_HANDLED);
+    handled[num_handled++] = (struct Handled_timer_event){
+        .timestamp_ms    = evf_get_timestamp_ms(),
+        .timer_id        = p_timer_event->timer_id,
+        .num_expirations = p_timer_event->num_expirations,
+    };
+
+    if (num_busy_handlings > 0)
+    {
+        num_busy_handlings--;
+        evf_sim_busy(busy_ms);
+    }
+
+    return EVF_ACTIVE_OBJECT_STATUS_RUNNING;
+}
+
+static void set_up()
+{
+    evf_sim_reset();
+    num_handled = 0;
+    busy_ms = 0;
+    num_busy_handlings = 0;
+
+    evf_init();
+    evf_register_active_object(&timer_owner);
+}
+
+static void check_handled(uint32_t index, uint64_t timestamp_ms, uint32_t timer_id, uint32_t num_expirations)
+{
+    EVF_TEST_CHECK(index < num_handled);
+    EVF_TEST_CHECK(handled[index].timestamp_ms == timestamp_ms);
+    EVF_TEST_CHECK(handled[index].timer_id == timer_id);
+    EVF_TEST_CHECK(handled[index].num_expirations == num_expirations);
+}
+
+/**************************************************************************************************
+ * Tests
+ *************************************************************************************************/
+
+// Timers whose slack windows overlap finish together, at the latest time that suits all of them.
+static void test_timers_within_slack_are_coalesced()
+{
+    set_up();
+    struct Evf_timer * timers[] = { &exact_timer_d, &slack_timer_a, &slack_timer_b, &exact_timer_c };
+    for (uint32_t i = 0; i < 4; i++)
+    {
+        evf_timer_init(timers[i]);
+        evf_timer_start(timers[i]);
+    }
+
+    uint64_t wakeup_timestamp_ms = 0;
+    EVF_TEST_CHECK(evf_get_next_wakeup(&wakeup_timestamp_ms) == EVF_NEXT_WAKEUP_AT_TIMESTAMP);
+    EVF_TEST_CHECK(wakeup_timestamp_ms == 108);
+
+    evf_sim_run_until_idle();
+    EVF_TEST_CHECK(num_handled == 4);
+    check_handled(0, 108, 1, 1);
+    check_handled(1, 108, 2, 1);
+    check_handled(2, 108, 3, 1);
+    check_handled(3, 200, 4, 1);
+}
+
+// A lone timer with slack finishes at the end of its slack window.
+static void test_lone_timer_finishes_at_end_of_slack()
+{
+    set_up();
+    evf_timer_init(&slack_timer_a);
+    evf_timer_start(&slack_timer_a);
+
+    evf_sim_run_until_idle();
+    EVF_TEST_CHECK(num_handled == 1);
+    check_handled(0, 110, 1, 1);
+}
+
+// Handling takes time, but periodic timers are re-armed from their deadlines so they don't drift.
+static void test_periodic_timer_does_not_drift()
+{
+    set_up();
+    busy_ms = 3;
+    num_busy_handlings = UINT32_MAX;
+    evf_timer_init(&periodic_timer);
+    evf_timer_start(&periodic_timer);
+
+    evf_sim_advance(100);
+    EVF_TEST_CHECK(num_handled == 10);
+    for (uint32_t i = 0; i < 10; i++)
+    {
+        check_handled(i, (i + 1) * 10, 5, 1);
+    }
+
+    // The last handling started at 100 ms and was busy until 103 ms.
+    EVF_TEST_CHECK(evf_get_timestamp_ms() == 103);
+    evf_timer_stop(&periodic_timer);
+}
+
+// A handler that is busy past the end of evf_sim_advance leaves the clock there, it never goes back.
+static void test_busy_past_advance_target_keeps_clock()
+{
+    set_up();
+    busy_ms = 50;
+    num_busy_handlings = 1;
+    evf_timer_init(&exact_timer_c);
+    evf_timer_start(&exact_timer_c);
+
+    evf_sim_advance(110);
+    EVF_TEST_CHECK(num_handled == 1);
+    check_handled(0, 108, 3, 1);
+    EVF_TEST_CHECK(evf_get_timestamp_ms() == 158);
+
+    evf_sim_advance(10);
+    EVF_TEST_CHECK(evf_get_timestamp_ms() == 168);
+}
+
+/* The first handling takes 35 ms, so the period that is due at 20 ms is only handled at 45 ms, by
+ * when the periods due at 30 ms and 40 ms have also been missed.
+ */
+static void start_late_periodic_timer(struct Evf_timer * p_timer)
+{
+    set_up();
+    busy_ms = 35;
+    num_busy_handlings = 1;
+    evf_timer_init(p_timer);
+    evf_timer_start(p_timer);
+    evf_sim_advance(55);
+    evf_timer_stop(p_timer);
+}
+
+static void test_catch_up_policy_coalesce()
+{
+    start_late_periodic_timer(&coalescing_timer);
+    EVF_TEST_CHECK(num_handled == 3);
+    check_handled(0, 10, 6, 1);
+    check_handled(1, 45, 6, 3);
+    check_handled(2, 50, 6, 1);
+}
+
+static void test_catch_up_policy_fire_all()
+{
+    start_late_periodic_timer(&fire_all_timer);
+    EVF_TEST_CHECK(num_handled == 5);
+    check_handled(0, 10, 7, 1);
+    check_handled(1, 45, 7, 1);
+    check_handled(2, 45, 7, 1);
+    check_handled(3, 45, 7, 1);
+    check_handled(4, 50, 7, 1);
+}
+
+static void test_catch_up_policy_skip()
+{
+    start_late_periodic_timer(&skipping_timer);
+    EVF_TEST_CHECK(num_handled == 3);
+    check_handled(0, 10, 8, 1);
+    check_handled(1, 45, 8, 1);
+    check_handled(2, 50, 8, 1);
+}
+
+static void test_next_wakeup()
+{
+    set_up();
+    uint64_t wakeup_timestamp_ms = 0;
+    EVF_TEST_CHECK(evf_get_next_wakeup(&wakeup_timestamp_ms) == EVF_NEXT_WAKEUP_NONE);
+
+    evf_timer_init(&slack_timer_b);
+    evf_timer_start(&slack_timer_b);
+    EVF_TEST_CHECK(evf_get_next_wakeup(&wakeup_timestamp_ms) == EVF_NEXT_WAKEUP_AT_TIMESTAMP);
+    EVF_TEST_CHECK(wakeup_timestamp_ms == 115);
+
+    struct Evf_event * p_event = EVF_EVENT_ALLOC(struct Evf_event);
+    evf_event_set_type(p_event, EVENT_TYPE_TEST);
+    EVF_TEST_CHECK(evf_post(&timer_owner, p_event));
+    EVF_TEST_CHECK(evf_get_next_wakeup(&wakeup_timestamp_ms) == EVF_NEXT_WAKEUP_NOW);
+
+    evf_sim_advance(0);
+    EVF_TEST_CHECK(evf_get_next_wakeup(&wakeup_timestamp_ms) == EVF_NEXT_WAKEUP_AT_TIMESTAMP);
+    EVF_TEST_CHECK(wakeup_timestamp_ms == 115);
+
+    evf_timer_stop(&slack_timer_b);
+    EVF_TEST_CHECK(evf_get_next_wakeup(&wakeup_timestamp_ms) == EVF_NEXT_WAKEUP_NONE);
+}
+
+// The EVF's cached callback timestamp must not survive a reset, or an identical timer never finishes.
+static void test_timer_finishes_after_reset()
+{
+    set_up();
+    evf_timer_init(&exact_timer_c);
+    evf_timer_start(&exact_timer_c);
+
+    set_up();
+    evf_timer_init(&exact_timer_c);
+    evf_timer_start(&exact_timer_c);
+    EVF_TEST_CHECK(evf_sim_run_until_idle() == 108);
+    EVF_TEST_CHECK(num_handled == 1);
+    check_handled(0, 108, 3, 1);
+}
+
+int main()
+{
+    EVF_TEST_RUN(test_timers_within_slack_are_coalesced);
+    EVF_TEST_RUN(test_lone_timer_finishes_at_end_of_slack);
+    EVF_TEST_RUN(test_periodic_timer_does_not_drift);
+    EVF_TEST_RUN(test_busy_past_advance_target_keeps_clock);
+    EVF_TEST_RUN(test_catch_up_policy_coalesce);
+    EVF_TEST_RUN(test_catch_up_policy_fire_all);
+    EVF_TEST_RUN(test_catch_up_policy_skip);
+    EVF_TEST_RUN(test_next_wakeup);
+    EVF_TEST_RUN(test_timer_finishes_after_reset);
+
+    printf("PASSED\n");
+    return 0;
+}
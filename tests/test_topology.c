@@ -0,0 +1,123 @@
+/**************************************************************************************************
+ * The static topology (see evf_topology.h) on the simulation port: published events reach exactly
+ * the listed subscribers, and event types can be listed without any subscribers.
+ *************************************************************************************************/
+
+#include "../evf.h"
+#include "../port/evf_port.h"
+#include "../port/evf_port_sim.h"
+#include "evf_test.h"
+
+enum Test_event_types
+{
+    EVENT_TYPE_SHARED = EVF_USER_EVENT_TYPES_START,
+    EVENT_TYPE_LISTENER_ONLY,
+    EVENT_TYPE_NO_SUBSCRIBERS,
+    EVENT_TYPE_UNLISTED,
+};
+
+/**************************************************************************************************
+ * Static Variables
+ *************************************************************************************************/
+
+static enum Evf_active_object_status counting_handler(struct Evf_active_object * p_self,
+                                                      struct Evf_event const * p_event);
+
+static uint32_t num_handled_by_publisher;
+static uint32_t num_handled_by_listener;
+
+static struct Evf_active_object publisher = {
+    .name         = "Publisher",
+    .priority     = 1,
+    .handle_event = &counting_handler,
+};
+
+static struct Evf_active_object listener = {
+    .name         = "Listener",
+    .priority     = 2,
+    .handle_event = &counting_handler,
+};
+
+#define EVF_TOPOLOGY_ACTIVE_OBJECTS(X) \
+    X(&publisher) \
+    X(&listener)
+
+#define EVF_TOPOLOGY_SUBSCRIPTIONS(X) \
+    X(EVENT_TYPE_SHARED, &publisher, &listener, NULL) \
+    X(EVENT_TYPE_LISTENER_ONLY, &listener, NULL) \
+    X(EVENT_TYPE_NO_SUBSCRIBERS, NULL)
+
+#include "../evf_topology.h"
+
+/**************************************************************************************************
+ * Static Functions
+ *************************************************************************************************/
+
+static enum Evf_active_object_status counting_handler(struct Evf_active_object * p_self,
+                                                      struct Evf_event const * p_event)
+{
+    (void)p_event;
+    if (p_self == &publisher) { num_handled_by_publisher++; }
+    if (p_self == &listener) { num_handled_by_listener++; }
+    return EVF_ACTIVE_OBJECT_STATUS_RUNNING;
+}
+
+static void set_up()
+{
+    evf_sim_reset();
+    num_handled_by_publisher = 0;
+    num_handled_by_listener = 0;
+    evf_init();
+}
+
+static void publish(struct Evf_active_object * p_publisher, int32_t type)
+{
+    struct Evf_event * p_event = EVF_EVENT_ALLOC(struct Evf_event);
+    evf_event_set_type(p_event, type);
+    evf_publish(p_publisher, p_event);
+}
+
+/**************************************************************************************************
+ * Tests
+ *************************************************************************************************/
+
+static void test_registry_is_in_listed_order()
+{
+    set_up();
+    EVF_TEST_CHECK(evf_get_active_object_index(&publisher) == 0);
+    EVF_TEST_CHECK(evf_get_active_object_index(&listener) == 1);
+}
+
+// Each subscriber gets the event, except for its publisher.
+static void test_published_events_reach_listed_subscribers()
+{
+    set_up();
+    publish(NULL, EVENT_TYPE_SHARED);
+    publish(&publisher, EVENT_TYPE_SHARED);
+    publish(NULL, EVENT_TYPE_LISTENER_ONLY);
+    evf_sim_run_until_idle();
+
+    EVF_TEST_CHECK(num_handled_by_publisher == 1);
+    EVF_TEST_CHECK(num_handled_by_listener == 3);
+}
+
+static void test_event_types_without_subscribers()
+{
+    set_up();
+    publish(NULL, EVENT_TYPE_NO_SUBSCRIBERS);
+    publish(NULL, EVENT_TYPE_UNLISTED);
+    EVF_TEST_CHECK(!evf_check_if_work_to_do());
+
+    EVF_TEST_CHECK(num_handled_by_publisher == 0);
+    EVF_TEST_CHECK(num_handled_by_listener == 0);
+}
+
+int main()
+{
+    EVF_TEST_RUN(test_registry_is_in_listed_order);
+    EVF_TEST_RUN(test_published_events_reach_listed_subscribers);
+    EVF_TEST_RUN(test_event_types_without_subscribers);
+
+    printf("PASSED\n");
+    return 0;
+}
@@ -0,0 +1,156 @@
+/**************************************************************************************************
+ * The watchdog thread (see evf_linux_watchdog_start) on the Linux port: a step that overruns its
+ * run-to-completion budget is reported while it is still in progress, and a step within its
+ * budget is not. Every test is run under an alarm, so that a report that never arrives fails the
+ * test rather than hanging it.
+ *************************************************************************************************/
+
+#include "../evf.h"
+#include "../port/evf_port.h"
+#include "../port/evf_port_linux.h"
+#include "evf_test.h"
+#include <stdatomic.h>
+#include <unistd.h>
+
+#define TEST_TIMEOUT_S    10
+
+#define RTC_BUDGET_US                1000
+#define WATCHDOG_BUDGET_MULTIPLIER   2
+#define WATCHDOG_CHECK_PERIOD_MS     5
+
+enum Test_event_types
+{
+    EVENT_TYPE_WORK = EVF_USER_EVENT_TYPES_START,
+};
+
+struct Event_work
+{
+    struct Evf_event base;
+    bool is_stuck; // Busy until the watchdog has reported the step, rather than returning at once.
+};
+
+/**************************************************************************************************
+ * Static Variables
+ *************************************************************************************************/
+
+static enum Evf_active_object_status worker_handler(struct Evf_active_object * p_self,
+                                                    struct Evf_event const * p_event);
+
+static struct Evf_active_object worker = {
+    .name          = "Worker",
+    .priority      = 1,
+    .handle_event  = &worker_handler,
+    .rtc_budget_us = RTC_BUDGET_US,
+    .event_type_subscriptions = { EVF_EVENT_TYPE_NULL },
+};
+
+// Written by the watchdog thread.
+static atomic_uint num_watchdog_reports;
+static struct Evf_rtc_step_info reported_step;
+static uint64_t reported_duration_us;
+
+static uint32_t num_overruns_reported;
+
+/**************************************************************************************************
+ * Static Functions
+ *************************************************************************************************/
+
+static enum Evf_active_object_status worker_handler(struct Evf_active_object * p_self,
+                                                    struct Evf_event const * p_event)
+{
+    (void)p_self;
+    if (((struct Event_work const *)p_event)->is_stuck)
+    {
+        while (atomic_load(&num_watchdog_reports) == 0) { usleep(1000); }
+    }
+
+    return EVF_ACTIVE_OBJECT_STATUS_RUNNING;
+}
+
+static void record_watchdog_report(struct Evf_rtc_step_info const * p_step, uint64_t duration_us)
+{
+    reported_step = *p_step;
+    reported_duration_us = duration_us;
+    atomic_fetch_add(&num_watchdog_reports, 1);
+}
+
+static void record_overrun(struct Evf_active_object const * p_ao,
+                           struct Evf_event const * p_event,
+                           uint64_t duration_us)
+{
+    EVF_TEST_CHECK(p_ao == &worker);
+    num_overruns_reported++;
+}
+
+static void set_up()
+{
+    evf_deinit();
+    atomic_store(&num_watchdog_reports, 0);
+    num_overruns_reported = 0;
+
+    evf_init();
+    evf_register_active_object(&worker);
+    evf_register_rtc_budget_overrun_hook(&record_overrun);
+    evf_linux_register_watchdog_hook(&record_watchdog_report);
+    EVF_TEST_CHECK(evf_linux_watchdog_start(WATCHDOG_BUDGET_MULTIPLIER, WATCHDOG_CHECK_PERIOD_MS));
+    alarm(TEST_TIMEOUT_S);
+}
+
+static void tear_down()
+{
+    evf_linux_watchdog_stop();
+    evf_linux_register_watchdog_hook(NULL);
+    alarm(0);
+}
+
+static void post_work(bool is_stuck)
+{
+    struct Event_work * p_event = EVF_EVENT_ALLOC(struct Event_work);
+    evf_event_set_type(p_event, EVENT_TYPE_WORK);
+    p_event->is_stuck = is_stuck;
+    EVF_TEST_CHECK(evf_post(&worker, &p_event->base));
+}
+
+/**************************************************************************************************
+ * Tests
+ *************************************************************************************************/
+
+// The handler only returns once the watchdog has reported it, so the report must be made mid-step.
+static void test_stuck_step_is_reported()
+{
+    set_up();
+    post_work(true);
+    while (evf_check_if_work_to_do()) { evf_task(); }
+
+    EVF_TEST_CHECK(atomic_load(&num_watchdog_reports) == 1);
+    EVF_TEST_CHECK(reported_step.p_ao == &worker);
+    EVF_TEST_CHECK(reported_step.event_type == EVENT_TYPE_WORK);
+    EVF_TEST_CHECK(reported_duration_us > RTC_BUDGET_US * WATCHDOG_BUDGET_MULTIPLIER);
+
+    // The step also counts as an overrun once it has ended.
+    EVF_TEST_CHECK(num_overruns_reported == 1);
+    EVF_TEST_CHECK(evf_get_num_rtc_budget_overruns(&worker) == 1);
+    tear_down();
+}
+
+static void test_step_within_budget_is_not_reported()
+{
+    set_up();
+    post_work(false);
+    while (evf_check_if_work_to_do()) { evf_task(); }
+
+    // Give the watchdog a few checks, none of which should find a step in progress.
+    usleep(4 * WATCHDOG_CHECK_PERIOD_MS * 1000);
+    EVF_TEST_CHECK(atomic_load(&num_watchdog_reports) == 0);
+    EVF_TEST_CHECK(num_overruns_reported == 0);
+    tear_down();
+}
+
+int main()
+{
+    EVF_TEST_RUN(test_stuck_step_is_reported);
+    EVF_TEST_RUN(test_step_within_budget_is_not_reported);
+
+    printf("PASSED\n");
+    return 0;
+}
@@ -1,6 +1,7 @@
 
 
 #include "../evf.h"
+#include "../port/evf_port.h"
 #include <assert.h>
 #include <stdio.h>
 #include <stdlib.h>
@@ -43,19 +44,19 @@ struct Test_active_object_b
 };
 
 
-enum Evf_status test_active_object_a_handler(struct Evf_active_object * p_self, 
+enum Evf_active_object_status test_active_object_a_handler(struct Evf_active_object * p_self, 
                                             struct Evf_event const * p_event)
 {
     printf("Test_active_object_a (%s) handling event %d\n", p_self->name, p_event->type);
-    return EVF_STATUS_RUNNING;
+    return EVF_ACTIVE_OBJECT_STATUS_RUNNING;
 }
 
 
-enum Evf_status test_active_object_b_handler(struct Evf_active_object * p_self, 
+enum Evf_active_object_status test_active_object_b_handler(struct Evf_active_object * p_self, 
                                             struct Evf_event const * p_event)
 {
     printf("Test_active_object_b (%s) handling event %d\n", p_self->name, p_event->type);
-    return EVF_STATUS_RUNNING;
+    return EVF_ACTIVE_OBJECT_STATUS_RUNNING;
 }
 
 struct Test_active_object_a test_active_object_a1 = {